@@ -0,0 +1,176 @@
+/**
+ * Crystal Calibration for PIC16F18346
+ *
+ * Correction arithmetic: the ppm value is kept as k = p × 2^28 (16 bits
+ * for ±200 ppm, 0.004 ppm steps), so a correction is one 12 × 16-bit
+ * product and shifts:
+ *
+ *   NCO:      Δ = (inc >> 8)   × k >> 20   (inc < 2^20)
+ *   Software: Δ = (half >> 12) × k >> 16   (half < 2^24)
+ *
+ * The truncated low bits move Δ by less than 0.1 of an increment or one
+ * Fosc cycle. k = centi × 2^28 / 10^8 ≈ centi × 175922 / 2^16. For the NCO
+ * the 16 bits of the product below Δ are kept as the fraction to dither.
+ *
+ * TMR1 register usage during a measurement:
+ *
+ *   T1GPPS = 0x11       T1G = RC1 (Port C base 0x10, pin 1)
+ *   T1CON  = 0x43       TMR1CS = Fosc, 1:1, 16-bit read/write, on
+ *   T1GCON = 0xF0       Gate enabled, active high, toggle, single pulse
+ *
+ * and restored to the stream setup (T1CON = 0x83, T1GCON = 0x00) after.
+ */
+
+#include <xc.h>
+#include "cal.h"
+
+#define FOSC_HZ         24000000UL
+#define CAL_COUNTS      48000000UL  /* Sum at least 2 s of reference periods */
+
+static int16_t centi;
+static uint16_t k;                  /* |p| × 2^28 */
+static uint8_t fast;                /* Crystal fast: lower the frequency values */
+
+static volatile uint8_t busy;
+static volatile uint16_t ovf;       /* TMR1 overflows in this period */
+static volatile uint32_t sum;       /* Fosc counts over all periods */
+static volatile uint16_t periods;
+static uint16_t ref;
+
+void cal_set(int16_t centi_ppm) {
+    uint16_t a = (uint16_t)(centi_ppm < 0 ? -centi_ppm : centi_ppm);
+
+    centi = centi_ppm;
+    fast = centi_ppm > 0;
+    k = (uint16_t)(((uint32_t)a * 175922UL + 0x8000UL) >> 16);
+}
+
+int16_t cal_get(void) {
+    return centi;
+}
+
+uint32_t cal_nco(uint32_t inc, uint16_t *frac) {
+    *frac = 0;
+    if (k == 0) {
+        return inc;
+    }
+    uint32_t p = (uint32_t)(uint16_t)(inc >> 8) * k;     /* Δ × 2^20 */
+    uint32_t d = p >> 20;
+    uint16_t f = (uint16_t)(p >> 4);
+
+    if (fast) {
+        if (f != 0) {
+            d++;                    /* inc − d − f = (inc − d − 1) + (1 − f) */
+            f = (uint16_t)(0x10000UL - f);
+        }
+        *frac = f;
+        return inc - d;
+    }
+    inc += d;
+    if (inc >= 0xFFFFFUL) {
+        return 0xFFFFFUL;
+    }
+    *frac = f;
+    return inc;
+}
+
+uint32_t cal_soft(uint32_t half) {
+    if (k == 0) {
+        return half;
+    }
+    uint32_t d = ((uint32_t)(uint16_t)(half >> 12) * k + 0x8000UL) >> 16;
+    return fast ? half + d : half - d;
+}
+
+static void arm(void) {
+    TMR1H = 0;
+    TMR1L = 0;
+    ovf = 0;
+    PIR1bits.TMR1GIF = 0;
+    T1GCONbits.T1GGO_nDONE = 1;     /* Count the next full period */
+}
+
+static void release(void) {
+    PIE1bits.TMR1IE = 0;
+    PIE1bits.TMR1GIE = 0;
+    T1CON = 0x00;
+    T1GCON = 0x00;
+    T1CON = 0x83;                   /* Back to counting T1CKI (stream.c) */
+    busy = 0;
+}
+
+uint8_t cal_start(uint16_t ref_hz) {
+    if (ref_hz == 0 || ref_hz > CAL_REF_MAX) {
+        return 0;
+    }
+    ref = ref_hz;
+    sum = 0;
+    periods = 0;
+
+    di();
+    T1CON = 0x00;
+    T1GPPS = 0x11;
+    T1GCON = 0xF0;
+    T1CON = 0x43;
+    PIR1bits.TMR1IF = 0;
+    PIE1bits.TMR1IE = 1;
+    PIE1bits.TMR1GIE = 1;
+    busy = 1;
+    arm();
+    ei();
+    return 1;
+}
+
+void cal_abort(void) {
+    di();
+    if (busy) {
+        periods = 0;
+        release();
+    }
+    ei();
+}
+
+uint8_t cal_busy(void) {
+    return busy;
+}
+
+uint8_t cal_result(int16_t *centi_ppm) {
+    if (periods == 0) {
+        return 0;
+    }
+
+    // Nominal count for the periods measured: periods × 24 MHz / ref
+    uint32_t expect = periods * (FOSC_HZ / ref) +
+                      (uint32_t)periods * (FOSC_HZ % ref) / ref;
+    int32_t dev = (int32_t)(sum - expect);
+    uint32_t limit = expect / (1000000UL / (CAL_PPM_MAX / 100));
+
+    if (dev > (int32_t)limit || dev < -(int32_t)limit) {
+        return 0;
+    }
+    // dev / expect in 0.01 ppm, without overflowing 32 bits
+    *centi_ppm = (int16_t)(dev * 10000L / (int32_t)(expect / 10000UL));
+    return 1;
+}
+
+void cal_isr(void) {
+    if (!busy) {
+        return;
+    }
+    // Overflows first: TMR1 stops when the gate closes, so one pending
+    // here belongs to the period that just ended
+    if (PIR1bits.TMR1IF) {
+        PIR1bits.TMR1IF = 0;
+        ovf++;
+    }
+    if (PIR1bits.TMR1GIF) {
+        uint8_t l = TMR1L;          /* Latches TMR1H (16-bit read mode) */
+        sum += ((uint32_t)ovf << 16) | ((uint16_t)TMR1H << 8) | l;
+        periods++;
+        if (sum >= CAL_COUNTS) {
+            release();
+        } else {
+            arm();
+        }
+    }
+}
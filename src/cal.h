@@ -0,0 +1,95 @@
+/**
+ * Crystal Calibration for PIC16F18346
+ *
+ * freq_table and synth.c assume an exact 24 MHz. A crystal that runs
+ * p ppm fast makes every frequency p ppm high, so the stored correction
+ * (settings.c, HEF row 0) scales each value when it is applied:
+ *
+ *   NCO increment:        inc  × (1 - p)   (cal_nco)
+ *   Software half period: half × (1 + p)   (cal_soft)
+ *
+ * The correction is only applied at retune time (clock.c), never per
+ * output cycle; with p = 0 a retune costs one compare more. The NCO's
+ * step is 11.44 Hz (at 100 kHz one increment is 114 ppm), so the part of
+ * a correction below one increment is returned as a 16-bit fraction and
+ * dithered by clock.c (clock.h, Dithering); with no fraction the tick
+ * returns at once. The software clock resolves 4 Fosc cycles, 0.33 ppm
+ * at 1 Hz.
+ *
+ * tempco.c adds a temperature-dependent term to the stored correction
+ * before it reaches cal_set.
+ *
+ * Measurement: a reference of known frequency on RC1 (the SYNC input)
+ * gates TMR1, which counts Fosc. In gate toggle + single pulse mode each
+ * measurement is exactly one reference period, so the sum over about 2 s
+ * of periods against the nominal 24 MHz count gives the crystal's error
+ * to a few 0.01 ppm with a 1 PPS or 1 kHz reference. The ISR only
+ * re-arms the gate and counts TMR1 overflows; periods it misses are
+ * skipped, not mis-measured.
+ *
+ * TMR1 normally counts RB6 (stream.c, clc_gate.c), so a measurement
+ * needs run, step or halt mode with no stream running; mode switches are
+ * held off until it ends.
+ */
+
+#ifndef CAL_H
+#define CAL_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define CAL_PPM_MAX     20000       /* ±200.00 ppm, in 0.01 ppm */
+#define CAL_REF_MAX     10000       /* Hz; reference on RC1 */
+
+/**
+ * Use a correction of `centi_ppm` (0.01 ppm, positive = crystal fast,
+ * within ±CAL_PPM_MAX). Takes effect at the next retune.
+ */
+void cal_set(int16_t centi_ppm);
+
+/**
+ * Correction in use, 0.01 ppm.
+ */
+int16_t cal_get(void);
+
+/**
+ * NCO increment corrected for the crystal (clamped to 20 bits); the
+ * fraction of an increment below it goes to *frac (1/65536).
+ */
+uint32_t cal_nco(uint32_t inc, uint16_t *frac);
+
+/**
+ * Software half period (Fosc cycles) corrected for the crystal.
+ */
+uint32_t cal_soft(uint32_t half);
+
+/**
+ * Start measuring against a reference of `ref_hz` (1..CAL_REF_MAX) on
+ * RC1. Takes TMR1 from the stream engine; the caller checks the mode.
+ * Returns 0 if the frequency is out of range.
+ */
+uint8_t cal_start(uint16_t ref_hz);
+
+/**
+ * Stop a measurement and give TMR1 back (e.g. no reference: timeout).
+ */
+void cal_abort(void);
+
+/**
+ * Nonzero while a measurement is running.
+ */
+uint8_t cal_busy(void);
+
+/**
+ * Result of the last finished measurement in 0.01 ppm. Returns 0 if it
+ * was beyond ±CAL_PPM_MAX (wrong reference frequency or none).
+ */
+uint8_t cal_result(int16_t *centi_ppm);
+
+/**
+ * TMR1 overflow and gate interrupt handler. Call from the ISR on every
+ * interrupt; it checks its own flags.
+ */
+void cal_isr(void);
+
+#endif /* CAL_H */
@@ -1,31 +1,75 @@
 /**
- * CLC Hardware Debounce for PIC16F18344
+ * CLC Hardware Debounce for PIC16F18346
  *
- * Adapted from Microchip's pic18f16q40-clc-switch-debouncing example
- * (3 CLC solution). Translated for PIC16F18344 register differences:
+ * Derived from Microchip's pic18f16q40-clc-switch-debouncing example
+ * (3 CLC solution), reduced to two CLCs by replacing the majority vote
+ * and output flip-flop with one J-K flip-flop. Translated for PIC16F18346
+ * register differences:
  *
  *   - Direct register names (CLC1SEL0) instead of indexed (CLCSELECT + CLCnSEL0)
  *   - Different CLC data input selection values (Table 21-1, DS40001800E):
  *       CLCIN0PPS  = 0x00   (Q40: 0x00)
- *       CLC1_OUT   = 0x04   (Q40: 0x22)
- *       CLC2_OUT   = 0x05   (Q40: 0x23)
  *       CLC3_OUT   = 0x06   (Q40: 0x24)
  *       TMR2 match = 0x1A   (Q40: 0x10)
- *   - Basic TMR2 clocked from Fosc/4 = 6 MHz (no LFINTOSC option)
- *     Prescaler 1:64, PR2 = 140 → period = (141 × 64) / 6 MHz ≈ 1.5 ms
+ *       TMR4 match = 0x1C
+ *       TMR6 match = 0x1E
+ *   - Basic TMR2/4/6 clocked from Fosc/4 = 6 MHz (no LFINTOSC option)
+ *     Prescaler 1:64, PRx = 140 → period = (141 × 64) / 6 MHz ≈ 1.5 ms
  */
 
 #include <xc.h>
 #include "clc_debounce.h"
 
-/* CLC data input source values for PIC16F18344 (Table 21-1, DS40001800E) */
+/* CLC data input source values, PIC16F18344/18346 (Table 21-1, DS40001800E) */
 #define CLC_IN_CLCIN0PPS    0x00
-#define CLC_IN_CLC1_OUT     0x04
-#define CLC_IN_CLC2_OUT     0x05
 #define CLC_IN_CLC3_OUT     0x06
 #define CLC_IN_TMR2_MATCH   0x1A
+#define CLC_IN_TMR4_MATCH   0x1C
+#define CLC_IN_TMR6_MATCH   0x1E
+
+/* Sampling timer registers, selected by CLC_DEBOUNCE_TIMER */
+#if CLC_DEBOUNCE_TIMER == 2
+#define DB_TCON             T2CON
+#define DB_PR               PR2
+#define DB_TMR              TMR2
+#define CLC_IN_DB_MATCH     CLC_IN_TMR2_MATCH
+#elif CLC_DEBOUNCE_TIMER == 4
+#define DB_TCON             T4CON
+#define DB_PR               PR4
+#define DB_TMR              TMR4
+#define CLC_IN_DB_MATCH     CLC_IN_TMR4_MATCH
+#elif CLC_DEBOUNCE_TIMER == 6
+#define DB_TCON             T6CON
+#define DB_PR               PR6
+#define DB_TMR              TMR6
+#define CLC_IN_DB_MATCH     CLC_IN_TMR6_MATCH
+#else
+#error "CLC_DEBOUNCE_TIMER must be 2, 4 or 6"
+#endif
+
+/*
+ * Sampling period. Same prescaler and period register as the original
+ * TMR2 setup, so the debounce timing does not depend on the timer chosen:
+ * (140 + 1) × 64 × 4 / 24 MHz = 1504 µs. The period is computed from the
+ * TxCKPS field and PRx value written below, so a change to either that
+ * moves it from 1.504 ms stops the build.
+ */
+#define DB_CKPS             3       /* TxCKPS<1:0>: prescaler 1:4^CKPS */
+#define DB_PERIOD           140     /* PRx */
+#define DB_TCON_ON          (0x04 | DB_CKPS)    /* TMRxON, postscaler 1:1 */
+#define DB_PRESCALE         (1U << (2 * DB_CKPS))
+#define DB_TICK_US          ((DB_PERIOD + 1UL) * DB_PRESCALE * 4UL / 24UL)
+
+#if DB_CKPS > 3 || DB_PERIOD > 255
+#error "Debounce timer field out of range"
+#endif
+#if DB_TICK_US != 1504
+#error "Debounce sampling period changed from 1.504 ms"
+#endif
 
 void clc_debounce_init(void) {
+    uint8_t intn;
+
     /*
      * Route step button (RC4) to CLCIN0 via PPS.
      * PPS input value: Port C base = 0x10, pin 4 → 0x14.
@@ -33,31 +77,31 @@ void clc_debounce_init(void) {
     CLCIN0PPS = 0x14;
 
     /*
-     * TMR2: ~1.5 ms sampling clock
+     * TMR2/4/6: ~1.5 ms sampling clock
      *
-     * Clock source = Fosc/4 = 6 MHz (only option on PIC16F18344 TMR2)
-     * Prescaler = 1:64  (T2CKPS = 0b11)
-     * PR2 = 140
+     * Clock source = Fosc/4 = 6 MHz (only option on PIC16F18346 TMR2/4/6)
+     * Prescaler = 1:64  (TxCKPS = 0b11)
+     * PRx = 140
      * Period = (140 + 1) × 64 / 6 MHz = 1.504 ms
      *
-     * T2CON bit layout:
+     * TxCON bit layout:
      *   [7]   unused
-     *   [6:3] T2OUTPS<3:0> = 0000 (postscaler 1:1)
-     *   [2]   TMR2ON = 1
-     *   [1:0] T2CKPS<1:0> = 11 (prescaler 1:64)
+     *   [6:3] TxOUTPS<3:0> = 0000 (postscaler 1:1)
+     *   [2]   TMRxON = 1
+     *   [1:0] TxCKPS<1:0> = 11 (prescaler 1:64)
      *
-     * T2CON = 0b00000111 = 0x07
+     * TxCON = 0b00000111 = 0x07
      */
-    T2CON = 0x00;       /* Stop TMR2 while configuring */
-    PR2   = 140;         /* Period register */
-    TMR2  = 0x00;        /* Clear counter */
-    T2CON = 0x07;        /* TMR2 ON, prescaler 1:64 */
+    DB_TCON = 0x00;      /* Stop timer while configuring */
+    DB_PR   = DB_PERIOD; /* Period register */
+    DB_TMR  = 0x00;      /* Clear counter */
+    DB_TCON = DB_TCON_ON; /* Timer ON, prescaler 1:64 (0x07) */
 
     /*
      * CLC3: 2-input D flip-flop with R (mode 0b101)
-     * Samples the raw switch input on each TMR2 tick.
+     * Samples the raw switch input on each timer tick.
      *
-     *   Data1 (→ Gate1 = CLK) = TMR2/PR2 match
+     *   Data1 (→ Gate1 = CLK) = TMRx/PRx match
      *   Data2 (→ Gate2 = D)   = CLCIN0 (raw switch on RC4)
      *   Gate3 (R) = no inputs  → reset inactive
      *   Gate4     = unused
@@ -66,7 +110,7 @@ void clc_debounce_init(void) {
      */
     CLC3CON  = 0x00;               /* Disable during setup */
     CLC3POL  = 0x00;               /* No polarity inversions */
-    CLC3SEL0 = CLC_IN_TMR2_MATCH;  /* Data1 = TMR2 match → CLK */
+    CLC3SEL0 = CLC_IN_DB_MATCH;    /* Data1 = timer match → CLK */
     CLC3SEL1 = CLC_IN_CLCIN0PPS;   /* Data2 = raw switch → D */
     CLC3SEL2 = CLC_IN_CLCIN0PPS;   /* Data3 = unused */
     CLC3SEL3 = CLC_IN_CLCIN0PPS;   /* Data4 = unused */
@@ -77,57 +121,40 @@ void clc_debounce_init(void) {
     CLC3CON  = 0x85;               /* Enable, mode = 2-input D-FF w/ R */
 
     /*
-     * CLC2: 4-input AND (mode 0b010)
-     * Implements majority vote: MAJ(raw_switch, CLC3_out, CLC1_out)
+     * CLC2: J-K flip-flop with R (mode 0b110)
+     * Changes state only when two consecutive samples agree:
+     *   J = raw ∧ prev   (released on two samples → set)
+     *   K = ¬raw ∧ ¬prev (pressed on two samples → clear)
+     * This is the final debounced output.
      *
-     * The majority function is decomposed as:
-     *   MAJ(A,B,C) = AB + AC + BC
-     *   Using inverted-input NAND gates:
-     *     Gate1: no inputs → 0, inverted by G1POL → 1 (constant true)
-     *     Gate2: ¬D2 | ¬D3 = NAND(switch, CLC3_out)
-     *     Gate3: ¬D2 | ¬D4 = NAND(switch, CLC1_out)
-     *     Gate4: ¬D3 | ¬D4 = NAND(CLC3_out, CLC1_out)
+     *   Data1 = TMRx/PRx match → Gate2 (CLK)
+     *   Data2 = CLCIN0 (raw switch)
+     *   Data3 = CLC3_OUT (previous sample)
      *
-     *   4-input AND output = 1·NAND·NAND·NAND
-     *   With output polarity inverted → NOT(NAND·NAND·NAND)
-     *     = OR(AND, AND, AND) = AB + AC + BC = MAJ(A,B,C)
+     * Gates OR their inputs, so the ANDs are built from inverted inputs
+     * and an inverted gate output (De Morgan):
+     *   Gate1 (J) = ¬(¬D2 ∨ ¬D3)
+     *   Gate3 (K) = ¬(D2 ∨ D3)
+     *   Gate4 (R) = no inputs → reset inactive
      *
-     *   Data1 = CLCIN0 (unused by gates, but must be valid)
-     *   Data2 = CLCIN0 (raw switch) → used inverted in Gates 2, 3
-     *   Data3 = CLC3_OUT (previous sample) → used inverted in Gates 2, 4
-     *   Data4 = CLC1_OUT (debounced output) → used inverted in Gates 3, 4
+     * The interrupt edge bits (LC2INTP/LC2INTN) belong to step_pulse.c,
+     * which may have set them already (step mode restored at startup).
      */
+    intn     = CLC2CON & 0x18;     /* LC2INTP, LC2INTN */
     CLC2CON  = 0x00;               /* Disable during setup */
-    CLC2POL  = 0x81;               /* Output inverted + Gate1 inverted */
-    CLC2SEL0 = CLC_IN_CLCIN0PPS;   /* Data1 = CLCIN0 (filler) */
+    CLC2POL  = 0x05;               /* Gate1 and Gate3 inverted */
+    CLC2SEL0 = CLC_IN_DB_MATCH;    /* Data1 = timer match → CLK */
     CLC2SEL1 = CLC_IN_CLCIN0PPS;   /* Data2 = raw switch */
     CLC2SEL2 = CLC_IN_CLC3_OUT;    /* Data3 = CLC3 output (prev sample) */
-    CLC2SEL3 = CLC_IN_CLC1_OUT;    /* Data4 = CLC1 output (debounced) */
-    CLC2GLS0 = 0x00;               /* Gate1: no inputs (→0, G1POL→1) */
-    CLC2GLS1 = 0x14;               /* Gate2: D2_inv + D3_inv */
-    CLC2GLS2 = 0x44;               /* Gate3: D2_inv + D4_inv */
-    CLC2GLS3 = 0x50;               /* Gate4: D3_inv + D4_inv */
-    CLC2CON  = 0x82;               /* Enable, mode = 4-input AND */
+    CLC2SEL3 = CLC_IN_CLCIN0PPS;   /* Data4 = unused */
+    CLC2GLS0 = 0x14;               /* Gate1(J):   D2_inv + D3_inv */
+    CLC2GLS1 = 0x02;               /* Gate2(CLK): D1 true */
+    CLC2GLS2 = 0x28;               /* Gate3(K):   D2 true + D3 true */
+    CLC2GLS3 = 0x00;               /* Gate4(R):   none (no reset) */
+    CLC2CON  = 0x86 | intn;        /* Enable, mode = J-K FF w/ R */
+}
 
-    /*
-     * CLC1: 2-input D flip-flop with R (mode 0b101)
-     * Samples the majority-vote output on each TMR2 tick.
-     * This is the final debounced output.
-     *
-     *   Data1 (→ Gate1 = CLK) = TMR2/PR2 match
-     *   Data2 (→ Gate2 = D)   = CLC2 output (majority vote)
-     *   Gate3 (R) = no inputs  → reset inactive
-     *   Gate4     = unused
-     */
-    CLC1CON  = 0x00;               /* Disable during setup */
-    CLC1POL  = 0x00;               /* No polarity inversions */
-    CLC1SEL0 = CLC_IN_TMR2_MATCH;  /* Data1 = TMR2 match → CLK */
-    CLC1SEL1 = CLC_IN_CLC2_OUT;    /* Data2 = majority result → D */
-    CLC1SEL2 = CLC_IN_CLCIN0PPS;   /* Data3 = unused */
-    CLC1SEL3 = CLC_IN_CLCIN0PPS;   /* Data4 = unused */
-    CLC1GLS0 = 0x02;               /* Gate1(CLK): D1 true */
-    CLC1GLS1 = 0x08;               /* Gate2(D):   D2 true */
-    CLC1GLS2 = 0x00;               /* Gate3(R):   none (no reset) */
-    CLC1GLS3 = 0x00;               /* Gate4:      unused */
-    CLC1CON  = 0x85;               /* Enable, mode = 2-input D-FF w/ R */
+uint16_t clc_debounce_age(void) {
+    // Whole prescaler steps counted, plus half the unreadable current one
+    return (uint16_t)DB_TMR * DB_PRESCALE + DB_PRESCALE / 2;
 }
@@ -1,17 +1,26 @@
 /**
- * CLC Hardware Debounce for PIC16F18344
+ * CLC Hardware Debounce for PIC16F18346
  *
- * Implements the "Three CLC" switch debounce solution from Microchip
+ * Based on the "Three CLC" switch debounce solution from Microchip
  * application example pic18f16q40-clc-switch-debouncing, adapted for
- * the PIC16F18344.
+ * the PIC16F18346 and reduced to two CLCs so that CLC1 is free for the
+ * NCO clock gate (clc_gate.h).
  *
- * The circuit uses TMR2 as a ~1.5 ms sampling clock and three CLCs:
- *   CLC3: D flip-flop samples raw switch (CLCIN0 = RC4) on TMR2 clock
- *   CLC2: 4-input AND implements majority vote of (raw, prev, debounced)
- *   CLC1: D flip-flop samples majority output on TMR2 → debounced result
+ * The circuit uses a basic 8-bit timer (TMR4 by default) as a ~1.5 ms
+ * sampling clock and two CLCs:
+ *   CLC3: D flip-flop samples raw switch (CLCIN0 = RC4) on timer clock
+ *   CLC2: J-K flip-flop on the same clock, set when the raw and previous
+ *         samples are both high, cleared when both are low → debounced
  *
- * The debounced output is readable from CLCDATA bit CLC1OUT with zero
- * CPU overhead — the CLC+TMR2 hardware runs autonomously.
+ * As with the majority vote it replaces, the output changes only after
+ * two consecutive samples agree (1.5-3 ms after the contact settles).
+ * The debounced output is readable from CLCDATA bit CLC2OUT with zero
+ * CPU overhead — the CLC+timer hardware runs autonomously.
+ *
+ * TMR2 is the only timer that can clock PWM5/PWM6 and the CCP PWM modes,
+ * so the sampling clock defaults to TMR4 to leave TMR2 free for output
+ * waveform generation. TMR2, TMR4 and TMR6 are identical basic timers on
+ * this part, so every choice gives the same 1.504 ms sampling period.
  *
  * Reference: https://github.com/microchip-pic-avr-examples/
  *            pic18f16q40-clc-switch-debouncing
@@ -21,11 +30,26 @@
 #define CLC_DEBOUNCE_H
 
 #include <xc.h>
+#include <stdint.h>
+
+/* Sampling timebase: 2 = TMR2, 4 = TMR4 (default), 6 = TMR6 */
+#ifndef CLC_DEBOUNCE_TIMER
+#define CLC_DEBOUNCE_TIMER  4
+#endif
 
 /**
- * Initialize the 3-CLC hardware debounce circuit for the step button (RC4).
+ * Initialize the 2-CLC hardware debounce circuit for the step button (RC4).
  * Must be called after I/O port configuration and before the main loop.
  */
 void clc_debounce_init(void);
 
+/**
+ * Fosc/4 counts since the last sampling tick, i.e. since the debounced
+ * output last could have changed, read from TMRx. TMRx counts in steps
+ * of the 1:64 prescaler, which is not readable, so the result is the
+ * expected midpoint of the current step (TMRx × 64 + 32): the true age
+ * is within ±32 counts (±5.3 µs) of it.
+ */
+uint16_t clc_debounce_age(void);
+
 #endif /* CLC_DEBOUNCE_H */
@@ -0,0 +1,49 @@
+/**
+ * CLC Divided Clock Output for PIC16F18346
+ *
+ * CLC4 toggle flip-flop:
+ *
+ *   Data1 = NCO1 output → Gate1 (CLK)
+ *   Data2 = CLC4 output → Gate2 (D), inverted
+ *   Gate3 (R): no inputs → 0; G3POL set to force reset
+ *   Gate4 (S): no inputs → 0, set inactive
+ *
+ * The reset is driven from firmware by flipping the Gate3 polarity bit,
+ * which needs no data input and takes effect immediately.
+ */
+
+#include <xc.h>
+#include "clc_divider.h"
+
+/* CLC data input source values, PIC16F18344/18346 (Table 21-1, DS40001800E) */
+#define CLC_IN_CLC4_OUT     0x07
+#define CLC_IN_NCO1_OUT     0x25
+
+#define CLC_POL_G3          0x04    /* LC4G3POL: gate 3 (R) inverted */
+
+void clc_divider_init(void) {
+    /* Route CLC4 output to RC0 (Table 13-3) */
+    RC0PPS = 0x07;
+
+    CLC4CON  = 0x00;               /* Disable during setup */
+    CLC4POL  = CLC_POL_G3;         /* Start held in reset */
+    CLC4SEL0 = CLC_IN_NCO1_OUT;    /* Data1 = NCO1 → CLK */
+    CLC4SEL1 = CLC_IN_CLC4_OUT;    /* Data2 = own output → D */
+    CLC4SEL2 = CLC_IN_CLC4_OUT;    /* Data3 = unused */
+    CLC4SEL3 = CLC_IN_CLC4_OUT;    /* Data4 = unused */
+    CLC4GLS0 = 0x02;               /* Gate1(CLK): D1 true */
+    CLC4GLS1 = 0x04;               /* Gate2(D):   D2 inverted */
+    CLC4GLS2 = 0x00;               /* Gate3(R):   none (POL drives it) */
+    CLC4GLS3 = 0x00;               /* Gate4(S):   none (no set) */
+    CLC4CON  = 0x84;               /* Enable, mode = 1-input D-FF w/ S,R */
+
+    CLC4POL  = 0x00;               /* Release reset */
+}
+
+void clc_divider_hold(void) {
+    CLC4POL = CLC_POL_G3;
+}
+
+void clc_divider_release(void) {
+    CLC4POL = 0x00;
+}
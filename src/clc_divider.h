@@ -0,0 +1,44 @@
+/**
+ * CLC Divided Clock Output for PIC16F18346
+ *
+ * CLC4 is configured as a toggle flip-flop clocked by the NCO1 output,
+ * giving a ÷2 clock on RC0 that is phase-locked to RB6 with no CPU
+ * involvement:
+ *
+ *   CLC4: 1-input D flip-flop with S and R (mode 0b100)
+ *     CLK = NCO1 output (same signal that drives RB6)
+ *     D   = ¬CLC4 output  → toggles on every rising edge of NCO1
+ *
+ * Edge relationship: RC0 changes state only on rising edges of RB6, one
+ * CLC propagation delay later. RC0 goes high on the first RB6 rising edge
+ * after the NCO is (re)started, because the flip-flop is held in reset
+ * while the NCO is stopped. Increment changes do not stop the NCO, so
+ * retuning keeps the divider phase.
+ *
+ * CLC1 is the NCO clock gate and CLC2-CLC3 the step button debounce, so
+ * only one divider stage is available; ÷4 would need a second free CLC.
+ */
+
+#ifndef CLC_DIVIDER_H
+#define CLC_DIVIDER_H
+
+#include <xc.h>
+
+/**
+ * Initialize CLC4 as a ÷2 toggle flip-flop from NCO1, output on RC0.
+ * Call after nco_init().
+ */
+void clc_divider_init(void);
+
+/**
+ * Hold the divider in reset (output low). Used while the NCO is stopped
+ * or reconfigured so the ÷2 phase restarts in a known state.
+ */
+void clc_divider_hold(void);
+
+/**
+ * Release the divider; it toggles on the next NCO1 rising edge.
+ */
+void clc_divider_release(void);
+
+#endif /* CLC_DIVIDER_H */
@@ -0,0 +1,196 @@
+/**
+ * CLC NCO Clock Gate for PIC16F18346
+ *
+ * CLC1 register usage (4-input AND, each gate ORs its selected inputs):
+ *
+ *   Data1 = FOSC        → Gate1 (true)
+ *   Data2 = CCP1 output → Gate2 (inverted) while a counted stop is armed;
+ *                         otherwise Gate2 has no inputs and G2POL makes it 1
+ *   Data3 = CLCIN1 (RC2) → Gate3 (true): WAIT, active low; with
+ *                         CLC_GATE_WAIT = 0, Gate3 has no inputs and
+ *                         G3POL makes it 1
+ *   Data4 = NCO1 output → Gate2 (inverted): ORed with ¬CCP1, so a stop
+ *                         only closes the gate while RB6 is high
+ *   Gate4: no inputs, G4POL → 1; cleared by clc_gate_hold
+ *
+ * CCP1 modes:
+ *   0x82  compare, toggle output (stream engine, output unused)
+ *   0x88  compare, set output on match; the output is cleared when the
+ *         mode is written, which is how a counted stop is re-armed
+ *
+ * TMR1 counts RB6 (T1CKIPPS = 0x0E) or, for instruction stepping, the
+ * SYNC input on RC1 (T1CKIPPS = 0x11, Port C base 0x10, pin 1).
+ *
+ * Halt watch: T1GPPS = 0x16 (RC6), T1GCON = 0x80 (gate enabled, active
+ * low, gate pin): TMR1 only counts RB6 while HALT_SEL is pressed, and a
+ * counted stop of one edge stays armed until it does.
+ *
+ * Counts beyond 16 bits: CCPR1 is set to the low 16 bits of the stop
+ * count, so it matches once per 65,536 edges before the final match.
+ * Those earlier matches only interrupt (Gate2 not yet selecting CCP1);
+ * clc_gate_isr counts them down and connects CCP1 to the gate for the
+ * last one, so the final stop is still pure hardware. The ISR only has
+ * to run within 65,536 output cycles of the preceding match.
+ */
+
+#include <xc.h>
+#include "clc_gate.h"
+
+/* CLC data input source values, PIC16F18344/18346 (Table 21-1, DS40001800E) */
+#define CLC_IN_CLCIN1PPS    0x01
+#define CLC_IN_FOSC         0x08
+#define CLC_IN_CCP1_OUT     0x0F
+#define CLC_IN_NCO1_OUT     0x25
+
+#define T1CKI_RB6           0x0E
+#define T1CKI_SYNC          0x11    /* RC1 */
+#define T1G_HALT            0x16    /* RC6 */
+
+#define CLC_POL_G2          0x02    /* Gate 2 forced to 1 (no inputs) */
+#define CLC_POL_G3          0x04    /* Gate 3 forced to 1 (no inputs) */
+#define CLC_POL_G4          0x08    /* Gate 4 forced to 1: not held */
+
+#define CCP1_STREAM         0x82
+#define CCP1_STOP           0x88
+
+static volatile uint16_t wraps;     /* Matches to pass before the final one */
+
+static uint16_t tmr1_now(void) {
+    uint8_t l = TMR1L;              /* Latches TMR1H (16-bit read mode) */
+    return ((uint16_t)TMR1H << 8) | l;
+}
+
+void clc_gate_init(void) {
+    /*
+     * Route WAIT (RC2) to CLCIN1 via PPS.
+     * PPS input value: Port C base = 0x10, pin 2 → 0x12.
+     */
+    CLCIN1PPS = 0x12;
+
+    CLC1CON  = 0x00;                /* Disable during setup */
+#if CLC_GATE_WAIT
+    CLC1POL  = CLC_POL_G2 | CLC_POL_G4;
+#else
+    CLC1POL  = CLC_POL_G2 | CLC_POL_G3 | CLC_POL_G4;
+#endif
+    CLC1SEL0 = CLC_IN_FOSC;         /* Data1 = FOSC */
+    CLC1SEL1 = CLC_IN_CCP1_OUT;     /* Data2 = CCP1 compare output */
+    CLC1SEL2 = CLC_IN_CLCIN1PPS;    /* Data3 = WAIT input */
+    CLC1SEL3 = CLC_IN_NCO1_OUT;     /* Data4 = NCO1 (RB6 level) */
+    CLC1GLS0 = 0x02;                /* Gate1: D1 true */
+    CLC1GLS1 = 0x00;                /* Gate2: none until a stop is armed */
+#if CLC_GATE_WAIT
+    CLC1GLS2 = 0x20;                /* Gate3: D3 true (WAIT released) */
+#else
+    CLC1GLS2 = 0x00;                /* Gate3: none */
+#endif
+    CLC1GLS3 = 0x00;                /* Gate4: none (POL drives it) */
+    CLC1CON  = 0x82;                /* Enable, mode = 4-input AND */
+}
+
+void clc_gate_hold(uint8_t hold) {
+    if (hold) {
+        CLC1POL &= ~CLC_POL_G4;
+    } else {
+        CLC1POL |= CLC_POL_G4;
+    }
+}
+
+uint8_t clc_gate_waiting(void) {
+    return CLC_GATE_WAIT && PORTCbits.RC2 == 0;
+}
+
+uint8_t clc_gate_held(void) {
+    return (CLC1POL & CLC_POL_G4) == 0;
+}
+
+/* Connect the CCP1 output to Gate2: the next match closes the gate */
+static void arm_final(void) {
+    CLC1GLS1 = 0x44;                /* Gate2: D2 inverted + D4 inverted */
+    CLC1POL &= ~CLC_POL_G2;
+}
+
+void clc_gate_count(uint32_t edges) {
+    uint8_t gie = INTCONbits.GIE;
+    uint16_t low = (uint16_t)edges;
+
+    di();
+    PIE4bits.CCP1IE = 0;
+    wraps = (uint16_t)(edges >> 16);
+    if (low == 0) {
+        wraps--;                    /* The last full wrap is the final match */
+    }
+
+    uint16_t stop = tmr1_now() + low;
+    CCP1CON = 0x00;
+    CCPR1H = (uint8_t)(stop >> 8);
+    CCPR1L = (uint8_t)stop;
+    CCP1CON = CCP1_STOP;            /* Output cleared: gate open */
+
+    if (wraps == 0) {
+        arm_final();
+    } else {
+        CLC1POL |= CLC_POL_G2;      /* Gate2 = 1 until the final match */
+        CLC1GLS1 = 0x00;
+        PIR4bits.CCP1IF = 0;
+        PIE4bits.CCP1IE = 1;
+    }
+    INTCONbits.GIE = gie;
+}
+
+void clc_gate_uncount(void) {
+    T1GCON = 0x00;                  /* TMR1 counts every edge again */
+    PIE4bits.CCP1IE = 0;
+    wraps = 0;
+    CLC1POL |= CLC_POL_G2;
+    CLC1GLS1 = 0x00;
+    CCP1CON = CCP1_STREAM;
+}
+
+void clc_gate_halt_watch(void) {
+    T1GPPS = T1G_HALT;
+    T1GCON = 0x80;                  /* Gate enabled, counts while RC6 low */
+    clc_gate_count(1);
+}
+
+uint8_t clc_gate_watching(void) {
+    return T1GCONbits.TMR1GE;
+}
+
+uint8_t clc_gate_armed(void) {
+    return CLC1GLS1 != 0 || wraps != 0;
+}
+
+void clc_gate_source(uint8_t sync) {
+    T1CKIPPS = sync ? T1CKI_SYNC : T1CKI_RB6;
+}
+
+uint8_t clc_gate_done(void) {
+    return CLC1GLS1 != 0 && CCP1CONbits.OUT;
+}
+
+uint32_t clc_gate_left(void) {
+    uint8_t gie = INTCONbits.GIE;
+    uint32_t left;
+
+    if (clc_gate_done() || (CLC1GLS1 == 0 && wraps == 0)) {
+        return 0;
+    }
+    di();
+    uint16_t stop = ((uint16_t)CCPR1H << 8) | CCPR1L;
+    left = ((uint32_t)wraps << 16) + (uint16_t)(stop - tmr1_now() - 1) + 1;
+    INTCONbits.GIE = gie;
+    return left;
+}
+
+void clc_gate_isr(void) {
+    if (wraps != 0 && PIE4bits.CCP1IE && PIR4bits.CCP1IF) {
+        PIR4bits.CCP1IF = 0;
+        if (--wraps == 0) {
+            PIE4bits.CCP1IE = 0;
+            CCP1CON = 0x00;
+            CCP1CON = CCP1_STOP;    /* Clear the output set by this match */
+            arm_final();
+        }
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * CLC NCO Clock Gate for PIC16F18346
+ *
+ * CLC1 sits between FOSC and the NCO1 clock input (NCO1CLK = LC1_out).
+ * While the gate is closed the NCO accumulator does not advance, so RB6,
+ * the CWG two-phase outputs and the CLC4 divider all hold their level,
+ * and when it opens the NCO carries on from the same phase: a half period
+ * can be stretched by the gate but never shortened, so there is no runt.
+ *
+ *   CLC1: 4-input AND (mode 0b010)
+ *     Gate1 = FOSC
+ *     Gate2 = ¬CCP1 output ∨ ¬NCO1 output  (counted stop, while armed)
+ *     Gate3 = WAIT input    (RC2, active low)
+ *     Gate4 = 1, forced to 0 by firmware (hold)
+ *
+ * WAIT: RC2 (weak pull-up) goes straight into Gate3. Pulling it low stops
+ * the NCO clock one CLC propagation delay later (a few ns), freezing RB6
+ * at whatever level it has; releasing it lets the accumulator continue,
+ * so the current half period is stretched by the wait and never cut
+ * short. WAIT is asynchronous to FOSC, so its edges can clip one FOSC
+ * pulse: the output edge after a wait may move by one FOSC cycle
+ * (42 ns). It needs no firmware and applies over the whole NCO range;
+ * the software clock (below 12 Hz) and step pulses ignore it.
+ *
+ * Counted stop: TMR1 counts RB6 rising edges (stream.c), CCP1 compares
+ * in "set output on match" mode and its output closes the gate. Gate2
+ * also looks at the NCO output, so a stop only takes effect while RB6 is
+ * high: the output always parks at its idle level. Counting RB6 itself,
+ * the stop comes just after the last counted cycle ends.
+ *
+ * With TMR1 switched to the SYNC input (clc_gate_source), one counted
+ * edge stops the clock on the next RB6 high phase after a SYNC rising
+ * edge: at once if RB6 is high, else when the current low phase ends.
+ * No CLC is left to latch SYNC itself, so TMR1/CCP1 act as the latch and
+ * CLC1 applies it.
+ *
+ * Stop latency from the RB6 edge is TMR1 input synchronisation plus the
+ * compare and CLC propagation, at most 6 Fosc cycles (250 ns). The NCO
+ * keeps accumulating for that long, so the stop is cycle-exact while a
+ * half period is longer than that: up to 2 MHz.
+ *
+ * Halt: in run mode the gate keeps a one-edge counted stop armed with
+ * TMR1 gated by HALT_SEL (RC6, active low), so TMR1 counts nothing until
+ * the switch is pressed. The first RB6 rising edge after that closes the
+ * gate and the output parks high, within one edge of the press and
+ * whatever the CPU is doing; firmware only notices on its next poll.
+ *
+ * Counts up to 2^32-1 edges: above 16 bits an interrupt per 65,536 edges
+ * extends CCP1, and only the final match drives the gate.
+ *
+ * CCP1 is shared with the stream engine. Arming the counted stop takes
+ * it out of the stream's compare-interrupt mode; the caller must make
+ * sure no stream or playlist is running.
+ */
+
+#ifndef CLC_GATE_H
+#define CLC_GATE_H
+
+#include <xc.h>
+#include <stdint.h>
+
+/* WAIT input on RC2: 1 = gates the NCO clock (default), 0 = ignored */
+#ifndef CLC_GATE_WAIT
+#define CLC_GATE_WAIT   1
+#endif
+
+/**
+ * Configure CLC1 as an open gate. Call before NCO1 is switched to the
+ * LC1_out clock.
+ */
+void clc_gate_init(void);
+
+/**
+ * Close (nonzero) or open the gate from firmware. Takes effect at once,
+ * whatever the output level.
+ */
+void clc_gate_hold(uint8_t hold);
+
+/**
+ * Nonzero while WAIT is asserted (RC2 low).
+ */
+uint8_t clc_gate_waiting(void);
+
+/**
+ * Nonzero while the gate is held by clc_gate_hold.
+ */
+uint8_t clc_gate_held(void);
+
+/**
+ * Let exactly `edges` (1..2^32-1) more RB6 rising edges through, then
+ * close. Clears a previous counted stop, so the NCO restarts at once if
+ * it was parked.
+ */
+void clc_gate_count(uint32_t edges);
+
+/**
+ * Disarm the counted stop (and the halt watch) and return TMR1/CCP1 to
+ * the stream engine.
+ */
+void clc_gate_uncount(void);
+
+/**
+ * Arm the halt watch: gate TMR1 with HALT_SEL (RC6) and stop after one
+ * counted RB6 rising edge, i.e. at the first high level once it is
+ * pressed.
+ */
+void clc_gate_halt_watch(void);
+
+/**
+ * Nonzero while the halt watch is armed (or has fired).
+ */
+uint8_t clc_gate_watching(void);
+
+/**
+ * Nonzero while a counted stop owns CCP1 (armed, wrapping or done).
+ */
+uint8_t clc_gate_armed(void);
+
+/**
+ * Count RB6 rising edges (0) or SYNC rising edges on RC1 (nonzero).
+ */
+void clc_gate_source(uint8_t sync);
+
+/**
+ * Nonzero once the counted edges have passed and the gate has closed.
+ */
+uint8_t clc_gate_done(void);
+
+/**
+ * Edges still to pass before a counted stop; 0 when none is armed.
+ */
+uint32_t clc_gate_left(void);
+
+/**
+ * Counted-stop wrap handler (CCP1 compare, counts above 65,535). Call
+ * from the ISR on every interrupt; it checks its own flags.
+ */
+void clc_gate_isr(void);
+
+#endif /* CLC_GATE_H */
@@ -0,0 +1,1057 @@
+/**
+ * Clock Output Engine for PIC16F18346
+ *
+ * NCO FDC mode: F_out = (24 MHz × NCO_INC) / 2^21
+ * Software mode: F_out = 24 MHz / (2 × half_period_cycles)
+ *
+ * Software clock timing:
+ *   TMR3 runs continuously at Fosc/4 (6 MHz, 4 Fosc cycles per count).
+ *   Its overflows extend it to 32 bits in soft_hi. CCP2 (compare mode,
+ *   not routed to a pin) interrupts when TMR3 matches the low 16 bits of
+ *   the next edge time; the ISR toggles RB6 only when the upper 16 bits
+ *   match as well, then schedules the following edge half a period later.
+ *   Table entries below 12 Hz give half periods of about 262,000 counts
+ *   and more, several overflows apart, but a glide keeps the software
+ *   clock up to its 2 kHz handover (GLIDE_CROSS_HALF), 1,498 counts or
+ *   250 µs. So the next edge may fall in the same overflow period as the
+ *   current one or many later; the soft_hi comparison covers both, and
+ *   the ISR reschedules well within 250 µs as long as the longest
+ *   interrupt (the `isr` WCET of T) stays well below it.
+ *
+ * Glide (clock_glide):
+ *   A run-mode retune sets a target; clock_tick moves the ramp position
+ *   (the increment × 4096, or the software half period in Fosc cycles)
+ *   toward it each millisecond and loads the integer increment when it
+ *   changes. Below 2 kHz the ramp runs on the software clock, whose
+ *   4-cycle steps are finer than the NCO's 11.44 Hz. The software clock
+ *   hands over to the NCO in its ISR at a rising edge, with the NCO
+ *   phase cleared, so the high phase is a full NCO half period; the NCO
+ *   hands over while RB6 is high, with the software clock's falling edge
+ *   scheduled where the accumulator would have overflowed.
+ *
+ * Staged stream records (clock_stage):
+ *   The record is converted when staged, so loading it is register
+ *   writes only. On the software clock, the ISR loads it at the rising
+ *   edge TMR1 counts as the record boundary, before it schedules the
+ *   next edge, so the new record's first high phase is already at the
+ *   new frequency (to the NCO it hands over as a glide does). On the NCO
+ *   it is loaded by the CCP1 boundary interrupt (clock_load_staged),
+ *   about 20 µs after the edge.
+ */
+
+#include <xc.h>
+#include "clock.h"
+#include "freq_table.h"
+#include "cwg_twophase.h"
+#include "clc_divider.h"
+#include "clc_gate.h"
+#include "step_pulse.h"
+#include "cal.h"
+#include "synth.h"
+
+#define GLIDE_Q         12              /* Ramp position: increment × 4096 */
+#define GLIDE_HAND      (1UL << 20)     /* Increment × half period (Fosc cycles) */
+#define GLIDE_CROSS_INC 175             /* NCO ramps from 2003 Hz up */
+#define GLIDE_CROSS_HALF 5992UL         /* and the software clock below */
+#define GLIDE_1KHZ      12000UL         /* Half period of 1 kHz, Fosc cycles */
+#define GLIDE_CYCLES    750UL           /* NCO cycles per tick per increment, 1/65536 */
+#define GLIDE_TICK_MAX  32768UL         /* Per cycle: a tick moves at most ×1.5 */
+#define GLIDE_MARGIN    512UL           /* Fosc cycles kept from an NCO toggle */
+
+static uint32_t active_entry;
+static int16_t active_fine;             /* Fine tune, ppm */
+static uint32_t fine_value;             /* Entry's value moved by active_fine */
+static uint16_t fine_frac;              /* and the fraction of an increment */
+static uint8_t active_mode;
+static uint8_t software_mode;          /* RB6 is GPIO (not NCO1) */
+
+static volatile uint16_t soft_hi;       /* TMR3 overflow count */
+static volatile uint32_t soft_next;     /* Next edge time, TMR3 counts */
+static volatile uint32_t soft_half;     /* Half period, TMR3 counts */
+static volatile uint32_t soft_burst;    /* Counted cycles left, 0 = free run */
+static volatile uint8_t soft_sync;      /* Stop at the next high after SYNC */
+
+static volatile uint32_t nco_inc;       /* Increment in use, before dithering */
+static volatile uint16_t nco_frac;      /* Its fraction, 1/65536 increment */
+static volatile uint16_t nco_acc;       /* Dither accumulator */
+static volatile uint8_t nco_up;         /* nco_inc + 1 is loaded */
+static volatile int16_t nco_spread;     /* Spread-spectrum offset (spread.c) */
+static volatile uint32_t nco_loaded;    /* Increment in NCO1INC now */
+
+static uint32_t run_from;               /* Count mode: cycle where the run began */
+static uint32_t run_len;                /* Its length, 0 while parking */
+
+static uint16_t glide_m;                /* Ratio per tick, 1/65536; 0 = jump */
+static uint8_t glide_flags;             /* CLOCK_GLIDE_* */
+static uint8_t glide_powerup = 1;       /* Soft start not yet done */
+static volatile uint8_t gliding;
+static volatile uint8_t glide_soft;     /* Target is a software half period */
+static volatile uint32_t glide_to;      /* Target increment or half period */
+static volatile uint16_t glide_frac;    /* and its fraction of an increment */
+static volatile uint8_t glide_cross;    /* Hand over to the other clock at */
+static volatile uint32_t glide_via;     /* this value, that one going on */
+static volatile uint32_t glide_from;    /* from this one */
+static volatile uint32_t glide_at;      /* Position: increment << GLIDE_Q or half */
+static volatile uint8_t glide_edge;     /* NCO takes over at the next rising edge */
+
+static volatile uint8_t staged;         /* A stream record waits (clock_stage) */
+static uint32_t staged_entry;
+static uint32_t staged_value;           /* Its crystal-corrected value */
+static uint16_t staged_frac;
+static uint16_t staged_edge;            /* TMR1 count of its first rising edge */
+
+/**
+ * Initialize the NCO (Numerically Controlled Oscillator)
+ *
+ * FDC mode output frequency = (Fosc × NCO_INC) / 2^21
+ */
+static void nco_init(void) {
+    // Configure RB6 as NCO1 output
+    TRISBbits.TRISB6 = 0;       // Output
+    ANSELBbits.ANSB6 = 0;       // Digital
+
+    // Route NCO1 to RB6 via PPS (Peripheral Pin Select)
+    RB6PPS = 0x1D;              // NCO1 output (0x1D per datasheet Table 13-3)
+
+    NCO1CON = 0x00;             // Disable NCO while configuring
+    NCO1CLK = 0x02;             // Clock source = LC1_out (FOSC through the CLC1 gate)
+
+    // Set initial value
+    NCO1INCU = 0x00;            // Upper bits
+    NCO1INCH = 0x00;            // High byte
+    NCO1INCL = 0x01;            // Low byte - minimum frequency initially
+
+    // Clear accumulator
+    NCO1ACCU = 0x00;
+    NCO1ACCH = 0x00;
+    NCO1ACCL = 0x00;
+
+    // Enable NCO in Fixed Duty Cycle (FDC) mode - 50% duty cycle output
+    NCO1CON = 0x90;             // N1EN=1, N1PFM=0 (FDC mode), N1POL=1
+}
+
+/**
+ * Load a 20-bit increment value, moved by the spread-spectrum offset
+ *
+ * NCO1INC is double-buffered: the new increment is taken on the NCO clock
+ * after NCO1INCL is written, so writing upper bytes first updates it
+ * atomically without stopping the NCO. The accumulator keeps its value,
+ * so the output changes frequency without a phase jump or runt pulse.
+ * The offset is sized for the increment by spread.c; until it catches up
+ * with a large retune the sum is kept within 1..SYNTH_MAX_INC.
+ */
+static void nco_write(uint32_t inc) {
+    int16_t d = nco_spread;
+
+    if (d < 0 && (uint16_t)-d >= inc) {
+        inc = 1;
+    } else {
+        inc += d;
+        if (inc > SYNTH_MAX_INC) {
+            inc = SYNTH_MAX_INC;
+        }
+    }
+    nco_loaded = inc;
+    NCO1INCU = (uint8_t)((inc >> 16) & 0x0F);  // Only 4 bits in upper
+    NCO1INCH = (uint8_t)((inc >> 8) & 0xFF);
+    NCO1INCL = (uint8_t)(inc & 0xFF);          // Loads all 20 bits
+}
+
+/**
+ * Update NCO frequency to inc + frac/65536. A nonzero fraction is
+ * dithered by clock_tick, which loads inc + 1 on the right share of
+ * 1 ms ticks (first-order accumulator), so the average is exact.
+ */
+static void nco_set_increment(uint32_t inc, uint16_t frac) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    nco_inc = inc;
+    nco_frac = frac;
+    nco_up = 0;
+    nco_write(inc);
+    INTCONbits.GIE = gie;
+}
+
+/**
+ * Restart the accumulator so the next half period is a full one. Only
+ * used while the gate is closed.
+ */
+static void nco_clear_phase(void) {
+    NCO1ACCU = 0x00;
+    NCO1ACCH = 0x00;
+    NCO1ACCL = 0x00;
+}
+
+/**
+ * Disconnect NCO from pin (for software, step and halt modes)
+ * Sets RB6 as regular GPIO output. The pin is GPIO before the NCO stops,
+ * so it never shows the disabled NCO output.
+ */
+static void nco_disconnect(void) {
+    clc_divider_hold();
+    LATBbits.LATB6 = 1;
+    RB6PPS = 0x00;              // Disconnect NCO from RB6, use LATB6
+    NCO1CON = 0x00;
+    cwg_twophase_source(0);     // Two-phase follows the RB6 pin
+}
+
+/**
+ * Reconnect NCO to pin, enabled first so the pin goes from LATB6 high
+ * straight to the (inverted) NCO output
+ */
+static void nco_connect(void) {
+    NCO1CON = 0x90;             // Enable NCO, FDC mode, inverted
+    RB6PPS = 0x1D;              // Route NCO1 to RB6
+    cwg_twophase_source(1);     // Two-phase follows NCO1 directly
+    clc_divider_release();
+}
+
+/* Fosc cycles until NCO1 toggles next, 0 if within GLIDE_MARGIN of it */
+static uint32_t nco_until_edge(void) {
+    uint32_t acc = ((uint32_t)NCO1ACCU << 16) | ((uint16_t)NCO1ACCH << 8) | NCO1ACCL;
+    uint32_t left = GLIDE_HAND - (acc & (GLIDE_HAND - 1));
+
+    if (left <= nco_loaded * GLIDE_MARGIN) {
+        return 0;
+    }
+    return left / nco_loaded;
+}
+
+/**
+ * Free-running TMR3 at Fosc/4, CCP2 compare on TMR3.
+ * The CCP2 interrupt stays off until the software clock is started.
+ */
+static void soft_init(void) {
+    T3CON = 0x00;
+    TMR3H = 0;
+    TMR3L = 0;
+    CCPTMRSbits.C2TSEL = 0b10;  // CCP2 timebase = TMR3
+    CCP2CON = 0x00;
+    PIR3bits.TMR3IF = 0;
+    PIE3bits.TMR3IE = 1;        // Keep soft_hi counting
+    T3CON = 0x01;               // Fosc/4, 1:1, on
+}
+
+/* Current TMR3 time extended to 32 bits; call with interrupts off */
+static uint32_t soft_now(void) {
+    uint8_t h, l;
+    do {
+        h = TMR3H;
+        l = TMR3L;
+    } while (h != TMR3H);
+
+    uint16_t hi = soft_hi;
+    if (PIR3bits.TMR3IF && h < 0x80) {
+        hi++;                   // Overflow not yet counted by the ISR
+    }
+    return ((uint32_t)hi << 16) | ((uint16_t)h << 8) | l;
+}
+
+/*
+ * Next edge `delay` TMR3 counts from now; call with interrupts off. Reads
+ * TMR3 as soft_now does, without the call: retunes from the ISR reach
+ * here through load and soft_start (see README, Call depth).
+ */
+static void soft_schedule(uint32_t delay) {
+    uint8_t h, l;
+    do {
+        h = TMR3H;
+        l = TMR3L;
+    } while (h != TMR3H);
+
+    uint16_t hi = soft_hi;
+    if (PIR3bits.TMR3IF && h < 0x80) {
+        hi++;
+    }
+    soft_next = (((uint32_t)hi << 16) | ((uint16_t)h << 8) | l) + delay;
+    CCPR2H = (uint8_t)(soft_next >> 8);
+    CCPR2L = (uint8_t)soft_next;
+    CCP2CON = 0x82;                     // Enable, compare mode (no pin)
+    PIR4bits.CCP2IF = 0;
+    PIE4bits.CCP2IE = 1;
+}
+
+/* Start with a low phase; `cycles` > 0 stops high after that many cycles */
+static void soft_start(uint32_t half_period, uint32_t cycles) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    soft_half = half_period >> 2;       // Fosc cycles → TMR3 counts
+    soft_burst = cycles;
+    soft_sync = 0;
+    LATBbits.LATB6 = 0;                 // Low phase first
+    soft_schedule(soft_half);
+    INTCONbits.GIE = gie;
+}
+
+/* Take over RB6 while it is high: the low phase begins `delay` counts on */
+static void soft_resume(uint32_t half_period, uint32_t delay) {
+    soft_half = half_period >> 2;
+    soft_burst = 0;
+    soft_sync = 0;
+    soft_schedule(delay);
+}
+
+/* New half period, used from the next edge on (phase-continuous) */
+static void soft_set(uint32_t half_period) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    soft_half = half_period >> 2;
+    INTCONbits.GIE = gie;
+}
+
+static void soft_stop(void) {
+    PIE4bits.CCP2IE = 0;
+    CCP2CON = 0x00;
+    LATBbits.LATB6 = 1;
+}
+
+/*
+ * `value` of `entry` (with `ffrac` of an increment) corrected for the
+ * crystal (cal.h); *frac gets the fraction of an NCO increment left to
+ * dither, from both. For the active entry `value` is fine_value: the
+ * fine tune's 64-bit product is done once per retune
+ * (clock_retune_fine), not here, so a reapply with interrupts off stays
+ * short.
+ */
+static uint32_t corrected(uint32_t entry, uint32_t value, uint16_t ffrac, uint16_t *frac) {
+    *frac = 0;
+    if (IS_SOFTWARE_MODE(entry)) {
+        return cal_soft(value);
+    }
+    value = cal_nco(value, frac);
+    *frac += ffrac;
+    if (*frac < ffrac && value < SYNTH_MAX_INC) {
+        value++;
+    }
+    return value;
+}
+
+/* value × r / 65536 in 16 × 16 bit products (r <= GLIDE_TICK_MAX) */
+static uint32_t glide_scale(uint32_t v, uint16_t r) {
+    return (v >> 16) * r + (((v & 0xFFFF) * r) >> 16);
+}
+
+/*
+ * How far the ramp may move from `v` in one tick: up by v × r, down by
+ * v × (r - r²), i.e. to about 1 / (1 + r), so neither direction is
+ * faster than the ratio r. r is glide_m, or per cycle glide_m times the
+ * output cycles in a tick (f / 1 kHz): a fraction of it below 1 kHz, a
+ * multiple above. The multiple is added, not compounded, and capped at
+ * GLIDE_TICK_MAX, so a tick holding many cycles is slower than the rate,
+ * never faster.
+ */
+static uint32_t glide_step(uint32_t v, uint8_t down) {
+    uint16_t r = glide_m;
+    uint32_t d;
+
+    if (!(glide_flags & CLOCK_GLIDE_CYCLE)) {
+        d = glide_scale(v, r);
+    } else if (software_mode) {
+        d = (GLIDE_1KHZ * r) >> 16;             // v × m × (12000 / v)
+        if (v < GLIDE_1KHZ) {
+            r <<= 1;                            // 1-2 kHz: 1-2 cycles a tick
+        }
+    } else {
+        // Cycles per tick in 1/16: increment × 750 / 65536 (2 or more,
+        // as the NCO ramps from GLIDE_CROSS_INC up)
+        uint32_t t = (r * (((v >> GLIDE_Q) * GLIDE_CYCLES) >> 12)) >> 4;
+        r = (t > GLIDE_TICK_MAX) ? (uint16_t)GLIDE_TICK_MAX : (uint16_t)t;
+        d = glide_scale(v, r);
+    }
+    if (down) {
+        d -= glide_scale(d, r);
+    }
+    return d;
+}
+
+/* Half period of increment n, Fosc cycles, rounded to TMR3 counts */
+static uint32_t half_of(uint32_t n, uint8_t longer) {
+    uint32_t h = GLIDE_HAND / n;
+
+    if (longer) {
+        return (h + 3 + (GLIDE_HAND % n != 0)) & ~3UL;
+    }
+    return h & ~3UL;
+}
+
+/* Increment of half period h, rounded up or down */
+static uint32_t inc_of(uint32_t h, uint8_t up) {
+    uint32_t n = GLIDE_HAND / h;
+
+    return (up && GLIDE_HAND % h != 0) ? n + 1 : n;
+}
+
+/*
+ * Route the ramp from where it is to the target: on the NCO from
+ * GLIDE_CROSS_INC up, on the software clock below, landing in the
+ * target's own clock. Where the clock changes, glide_cross is set: the
+ * current one runs to glide_via, the other goes on from glide_from,
+ * each rounded toward the target's side so the frequency never turns
+ * back. Called on a new target and after each handover.
+ */
+static void glide_plan(void) {
+    uint32_t t = glide_to;
+
+    glide_cross = 1;
+    if (software_mode) {
+        uint32_t h = glide_at;
+        uint8_t rising = h > GLIDE_HAND / t;
+
+        if (glide_soft) {
+            glide_cross = 0;
+        } else if (rising && t > GLIDE_CROSS_INC) {
+            // To the NCO at 2 kHz, or here if already above
+            glide_via = (h > GLIDE_CROSS_HALF) ? GLIDE_CROSS_HALF : h;
+            glide_from = inc_of(glide_via, 1);
+        } else {
+            // To the NCO on the target increment itself
+            glide_via = half_of(t, rising);
+            if (rising ? glide_via > h : glide_via < h) {
+                glide_via = h;
+            }
+            glide_from = t;
+        }
+    } else {
+        uint32_t c = glide_at >> GLIDE_Q;
+
+        if (glide_soft) {
+            if (c > GLIDE_HAND / t) {
+                // Falling: hand over at 2 kHz, or at the target above it
+                uint32_t k = inc_of(t, 1);
+                glide_via = (c < GLIDE_CROSS_INC) ? c : GLIDE_CROSS_INC;
+                if (glide_via < k) {
+                    glide_via = k;
+                }
+                glide_from = half_of(glide_via, 1);
+                if (glide_from > t) {
+                    glide_from = t;
+                }
+            } else {
+                // Rising: hand over here below 2 kHz, else at the target
+                glide_via = (c < GLIDE_CROSS_INC) ? c : GLIDE_HAND / t;
+                glide_from = half_of(glide_via, 0);
+                if (glide_from < t) {
+                    glide_from = t;
+                }
+            }
+        } else if (c == t || (c >= GLIDE_CROSS_INC && t >= GLIDE_CROSS_INC)) {
+            glide_cross = 0;
+        } else if (t < c) {
+            // Falling below 2 kHz: the software clock from 2 kHz on
+            glide_via = (c < GLIDE_CROSS_INC) ? c : GLIDE_CROSS_INC;
+            glide_from = half_of(glide_via, 1);
+        } else {
+            // Rising from below 2 kHz: the software clock from here
+            glide_via = c;
+            glide_from = half_of(c, 0);
+        }
+    }
+}
+
+/*
+ * Glide from where the output is toward `value` (+ frac), a software
+ * half period if `soft`. Call with interrupts off, then glide_plan (not
+ * called from here: one call level less on the ISR retune paths).
+ */
+static void glide_target(uint32_t value, uint16_t frac, uint8_t soft) {
+    if (!gliding) {
+        glide_at = software_mode ? soft_half << 2 : nco_inc << GLIDE_Q;
+        if (nco_up) {
+            nco_up = 0;
+            nco_write(nco_inc);
+        }
+    }
+    nco_frac = 0;                       // No dithering until it lands
+    glide_to = value;
+    glide_frac = frac;
+    glide_soft = soft;
+    glide_edge = 0;
+    gliding = 1;
+}
+
+/* Software clock ISR, rising edge: the NCO takes over at `inc` */
+static void soft_to_nco(uint32_t inc, uint16_t frac) {
+    soft_stop();
+    software_mode = 0;
+    nco_clear_phase();                  // A full half period before it toggles
+    nco_inc = inc;
+    nco_frac = frac;
+    nco_up = 0;
+    nco_write(inc);
+    nco_connect();
+}
+
+/* Software clock ISR, rising edge: the NCO goes on from here */
+static void glide_to_nco(void) {
+    glide_edge = 0;
+    soft_to_nco(glide_from, 0);
+    glide_at = glide_from << GLIDE_Q;
+    glide_plan();
+}
+
+/* One glide step, from clock_tick */
+static void glide_tick(void) {
+    uint32_t goal = glide_cross ? glide_via : glide_to;
+    uint32_t at = glide_at;
+
+    if (glide_edge) {
+        return;                         // Handed over in clock_isr
+    }
+    if (!software_mode) {
+        goal <<= GLIDE_Q;
+    }
+    if (at != goal) {
+        uint8_t down = at > goal;
+        uint32_t d = glide_step(at, down);
+        uint32_t unit = software_mode ? 4 : 1UL << GLIDE_Q;
+        if (d >= unit) {
+            // Whole increments (TMR3 counts), so the value loaded never
+            // moves further than the step
+            d &= ~(unit - 1);
+            at &= ~(unit - 1);
+        }
+        if (down) {
+            at = (at - goal > d) ? at - d : goal;
+        } else {
+            at = (goal - at > d) ? at + d : goal;
+        }
+        glide_at = at;
+        if (software_mode) {
+            soft_set(at);
+        } else if ((at >> GLIDE_Q) != nco_inc) {
+            nco_inc = at >> GLIDE_Q;
+            nco_write(nco_inc);
+        }
+        return;
+    }
+    if (!glide_cross) {
+        nco_frac = glide_frac;          // Landed: dither the fraction again
+        gliding = 0;
+        return;
+    }
+    if (software_mode) {
+        glide_edge = 1;
+        return;
+    }
+
+    // NCO high: the software clock takes RB6 over and falls when the
+    // accumulator would have overflowed
+    uint32_t left = PORTBbits.RB6 ? nco_until_edge() : 0;
+    if (left != 0) {
+        software_mode = 1;
+        if (clc_gate_watching()) {
+            clc_gate_uncount();         // Only watches the NCO output
+        }
+        nco_disconnect();
+        soft_resume(glide_from, left >> 2);
+        glide_at = glide_from;
+        glide_plan();
+    }
+}
+
+/* Start continuous output at the active entry */
+static void clock_start(void) {
+    uint16_t frac;
+    uint32_t value = corrected(active_entry, fine_value, fine_frac, &frac);
+
+    if (IS_SOFTWARE_MODE(active_entry)) {
+        software_mode = 1;
+        nco_disconnect();
+        soft_start(value, 0);
+    } else if (glide_powerup && (glide_flags & CLOCK_GLIDE_START) && glide_m != 0) {
+        uint8_t gie = INTCONbits.GIE;
+        software_mode = 1;
+        nco_disconnect();
+        soft_start(GLIDE_HAND, 0);      // Soft start from 11.44 Hz
+        di();
+        glide_target(value, frac, 0);
+        glide_plan();
+        INTCONbits.GIE = gie;
+    } else {
+        software_mode = 0;
+        nco_connect();
+        nco_set_increment(value, frac);
+    }
+    glide_powerup = 0;
+}
+
+/* A burst or counted run is still being output */
+static uint8_t counted_busy(void) {
+    if (software_mode) {
+        return PIE4bits.CCP2IE;
+    }
+    return !clc_gate_held() && !clc_gate_done();
+}
+
+/* Cycles of the current burst or counted run still to come */
+static uint32_t counted_left(void) {
+    uint8_t gie = INTCONbits.GIE;
+    uint32_t n;
+
+    if (software_mode) {
+        di();
+        n = soft_burst;
+        INTCONbits.GIE = gie;
+        return n;
+    }
+    return clc_gate_left();
+}
+
+/*
+ * Output exactly `cycles` full cycles at the active entry from the parked
+ * (idle high) state, starting with a full low half period. In instruction
+ * step mode TMR1 counts SYNC instead, so `cycles` are SYNC edges.
+ */
+static void counted_start(uint32_t cycles) {
+    uint16_t frac;
+    uint32_t value = corrected(active_entry, fine_value, fine_frac, &frac);
+
+    if (IS_SOFTWARE_MODE(active_entry)) {
+        if (!software_mode) {
+            software_mode = 1;
+            nco_disconnect();
+        }
+        if (active_mode == CLOCK_ISTEP) {
+            clc_gate_count(cycles);     // CCP1 latches the SYNC edge
+            soft_start(value, 0);
+            soft_sync = 1;
+        } else {
+            soft_start(value, cycles);
+        }
+    } else {
+        clc_gate_hold(1);
+        if (software_mode) {
+            software_mode = 0;
+            nco_connect();      // Starts idle high, clock held
+        }
+        nco_set_increment(value, frac);
+        nco_clear_phase();
+        clc_gate_count(cycles);
+        clc_gate_hold(0);
+    }
+}
+
+/* Burst, count and instruction step modes park high and use the counted stop */
+static uint8_t counted_mode(uint8_t mode) {
+    return mode == CLOCK_BURST || mode == CLOCK_COUNT || mode == CLOCK_ISTEP;
+}
+
+void clock_init(uint32_t entry, int16_t fine, uint8_t mode) {
+    clc_gate_init();
+    nco_init();
+    cwg_twophase_init();
+    clc_divider_init();
+    soft_init();
+    step_pulse_init();
+
+    active_entry = entry;
+    active_fine = fine;
+    fine_value = synth_fine(entry, fine, &fine_frac);
+    active_mode = CLOCK_HALT;   // Parked until the mode below starts
+    software_mode = 1;
+    nco_disconnect();
+    clock_set_mode(mode);
+}
+
+/* Load `value` (+ frac) of the active entry in run mode at once */
+static void load(uint32_t value, uint16_t frac) {
+    gliding = 0;
+    glide_edge = 0;
+    if (IS_SOFTWARE_MODE(active_entry)) {
+        if (software_mode) {
+            soft_set(value);
+        } else {
+            software_mode = 1;
+            if (clc_gate_watching()) {
+                clc_gate_uncount();     // Only watches the NCO output
+            }
+            nco_disconnect();
+            soft_start(value, 0);
+        }
+    } else {
+        if (software_mode) {
+            software_mode = 0;
+            soft_stop();
+            nco_connect();
+        }
+        nco_set_increment(value, frac);
+    }
+}
+
+/* Load (or glide to) the active entry and fine tune in run mode */
+static void retune(uint8_t exact) {
+    if (active_mode != CLOCK_RUN) {
+        return;                 // Applied when run mode resumes
+    }
+
+    uint16_t frac;
+    uint32_t value = corrected(active_entry, fine_value, fine_frac, &frac);
+    if (glide_m != 0 && !exact) {
+        uint8_t gie = INTCONbits.GIE;
+        di();
+        glide_target(value, frac, IS_SOFTWARE_MODE(active_entry) != 0);
+        glide_plan();
+        INTCONbits.GIE = gie;
+        return;
+    }
+    load(value, frac);
+}
+
+/*
+ * The stream record's entry becomes the active one, fine tune dropped.
+ * Returns its software half period or increment.
+ */
+static uint32_t take_staged(uint16_t *frac) {
+    staged = 0;
+    active_entry = staged_entry;
+    active_fine = 0;
+    fine_value = GET_FREQ_VALUE(staged_entry);
+    fine_frac = 0;
+    *frac = staged_frac;
+    return staged_value;
+}
+
+/* Software clock ISR, rising edge: load a record staged for this edge */
+static void staged_at_edge(void) {
+    uint8_t l = TMR1L;                  // Latches TMR1H; counted this edge
+    uint16_t edges = ((uint16_t)TMR1H << 8) | l;
+    uint16_t frac;
+
+    if (edges != staged_edge) {
+        return;
+    }
+    uint32_t value = take_staged(&frac);
+    gliding = 0;
+    if (IS_SOFTWARE_MODE(active_entry)) {
+        soft_half = value >> 2;         // From this high phase on
+    } else {
+        soft_to_nco(value, frac);
+    }
+}
+
+/* New active entry and fine tune; the caller retunes */
+static void set_entry(uint32_t entry, int16_t ppm) {
+    uint16_t frac;
+    uint32_t value = synth_fine(entry, ppm, &frac);
+
+    staged = 0;                         // Replaces a staged stream record
+    active_entry = entry;
+    active_fine = ppm;
+    fine_value = value;
+    fine_frac = frac;
+}
+
+void clock_retune(uint32_t entry) {
+    set_entry(entry, 0);
+    retune(0);
+}
+
+void clock_retune_exact(uint32_t entry) {
+    set_entry(entry, 0);
+    retune(1);
+}
+
+void clock_retune_fine(uint32_t entry, int16_t ppm) {
+    set_entry(entry, ppm);
+    retune(0);
+}
+
+void clock_stage(uint32_t entry, uint16_t edge) {
+    uint32_t value = GET_FREQ_VALUE(entry);
+
+    staged_frac = 0;                    // corrected() with no fine tune, inline
+    staged_value = IS_SOFTWARE_MODE(entry) ? cal_soft(value) : cal_nco(value, &staged_frac);
+    staged_entry = entry;
+    staged_edge = edge;
+    staged = 1;
+}
+
+uint8_t clock_load_staged(void) {
+    uint16_t frac;
+
+    if (!staged) {
+        return 0;                       // None, or loaded at its edge
+    }
+    uint32_t value = take_staged(&frac);
+    if (active_mode == CLOCK_RUN) {
+        load(value, frac);
+    }
+    return 1;
+}
+
+void clock_unstage(void) {
+    staged = 0;
+}
+
+/* Software clock: stop high at once, or at the end of the low phase */
+static void soft_park(void) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    if (LATBbits.LATB6) {
+        soft_stop();
+    } else {
+        soft_burst = 1;         // Stops on the coming rising edge
+        soft_sync = 0;
+    }
+    INTCONbits.GIE = gie;
+}
+
+/*
+ * Halt from run mode without cutting the current cycle. With the halt
+ * watch armed the gate may already have parked the output (HALT_SEL);
+ * otherwise one counted edge parks it at the next high level. While a
+ * stream owns TMR1/CCP1 there is no counted stop, so RB6 goes high now.
+ */
+static void halt_park(void) {
+    if (software_mode) {
+        soft_park();
+    } else if (!clc_gate_armed()) {
+        software_mode = 1;
+        nco_disconnect();
+    } else if (!clc_gate_done()) {
+        clc_gate_uncount();
+        clc_gate_count(1);
+    }
+}
+
+void clock_set_mode(uint8_t mode) {
+    if (mode == active_mode) {
+        return;
+    }
+    uint8_t from = active_mode;
+    active_mode = mode;
+    gliding = 0;                // Run mode restarts at the target
+    glide_edge = 0;
+
+    if (mode == CLOCK_HALT && from == CLOCK_RUN) {
+        halt_park();
+        return;
+    }
+
+    soft_stop();
+    if (from == CLOCK_STEP) {
+        step_pulse_enable(0);
+    }
+    if (from != CLOCK_RUN) {
+        nco_clear_phase();      // No short first half period on resume
+    }
+    if (clc_gate_armed()) {
+        clc_gate_uncount();
+    }
+    clc_gate_hold(0);
+    // Instruction step parks at the next SYNC, then steps on it
+    clc_gate_source(mode == CLOCK_ISTEP);
+
+    run_from = 0;
+    run_len = 0;
+    if (mode == CLOCK_RUN) {
+        clock_start();
+    } else if (counted_mode(mode) && from == CLOCK_RUN && !software_mode) {
+        clc_gate_count(1);      // Finish the current cycle, park high
+    } else {
+        software_mode = 1;
+        nco_disconnect();       // RB6 as GPIO, idle high
+        if (mode == CLOCK_STEP) {
+            step_pulse_enable(1);
+        }
+    }
+}
+
+void clock_halt_watch(uint8_t allow) {
+    if (active_mode != CLOCK_RUN) {
+        return;                 // Kept armed (or fired) through halt
+    }
+    uint8_t on = allow && !software_mode;
+    if (on && (!clc_gate_watching() || clc_gate_done())) {
+        if (clc_gate_done()) {
+            nco_clear_phase();  // HALT_SEL was tapped between two polls
+        }
+        clc_gate_halt_watch();
+    } else if (!on && clc_gate_watching()) {
+        clc_gate_uncount();
+    }
+}
+
+void clock_release_counter(void) {
+    if (active_mode == CLOCK_HALT && !software_mode && clc_gate_armed()) {
+        software_mode = 1;
+        nco_disconnect();       // Parked high already; keep it as GPIO
+    }
+    if (clc_gate_armed()) {
+        clc_gate_uncount();
+    }
+}
+
+uint8_t clock_burst(uint16_t cycles) {
+    if (active_mode != CLOCK_BURST || cycles == 0 || counted_busy()) {
+        return 0;
+    }
+    counted_start(cycles);
+    return 1;
+}
+
+uint8_t clock_run_to(uint32_t cycle) {
+    uint32_t now = clock_cycle();
+
+    if (active_mode != CLOCK_COUNT || cycle <= now || counted_busy()) {
+        return 0;
+    }
+    run_from = now;
+    run_len = cycle - now;
+    counted_start(run_len);
+    return 1;
+}
+
+uint8_t clock_step_sync(void) {
+    if (active_mode != CLOCK_ISTEP || counted_busy()) {
+        return 0;
+    }
+    counted_start(1);
+    return 1;
+}
+
+uint8_t clock_counting(void) {
+    return counted_mode(active_mode);
+}
+
+uint32_t clock_target(void) {
+    return run_from + run_len;
+}
+
+uint32_t clock_cycle(void) {
+    if (run_len == 0) {
+        return run_from;
+    }
+    return run_from + run_len - counted_left();
+}
+
+uint8_t clock_mode(void) {
+    return active_mode;
+}
+
+uint32_t clock_entry(void) {
+    return active_entry;
+}
+
+int16_t clock_fine(void) {
+    return active_fine;
+}
+
+void clock_reapply(void) {
+    uint8_t gie = INTCONbits.GIE;
+    uint16_t frac;
+
+    if (active_mode != CLOCK_RUN) {
+        return;                 // Applied when run mode resumes
+    }
+    di();
+    uint32_t value = corrected(active_entry, fine_value, fine_frac, &frac);
+    if (gliding) {
+        glide_target(value, frac, IS_SOFTWARE_MODE(active_entry) != 0);
+        glide_plan();
+    } else {
+        load(value, frac);
+    }
+    INTCONbits.GIE = gie;
+}
+
+uint32_t clock_time(void) {
+    return soft_now();
+}
+
+uint32_t clock_nco_inc(void) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    uint32_t inc = software_mode ? 0 : nco_inc;
+    INTCONbits.GIE = gie;
+    return inc;
+}
+
+void clock_spread(int16_t offset) {
+    nco_spread = offset;
+    nco_write(nco_inc + nco_up);
+}
+
+uint8_t clock_glide(uint16_t rate, uint8_t flags) {
+    uint16_t m = 0;
+
+    if (rate != 0) {
+        if (rate < CLOCK_GLIDE_MIN || rate > CLOCK_GLIDE_MAX) {
+            return 0;
+        }
+        // 0.01 % or 0.1 octave × ln 2 per 1000 ticks, in 1/65536, rounded down
+        m = (uint16_t)((rate * ((flags & CLOCK_GLIDE_CYCLE) ? 429497UL : 297704UL)) >> 16);
+    }
+    uint8_t gie = INTCONbits.GIE;
+    di();
+    glide_flags = flags;
+    glide_m = m;
+    if (m == 0 && gliding) {
+        retune(1);              // Land on the target at once
+    }
+    INTCONbits.GIE = gie;
+    return 1;
+}
+
+uint8_t clock_gliding(void) {
+    return gliding;
+}
+
+void clock_tick(void) {
+    if (gliding) {
+        glide_tick();
+        return;
+    }
+    if (nco_frac == 0) {
+        return;
+    }
+    uint16_t acc = nco_acc + nco_frac;
+    uint8_t up = acc < nco_acc;         // Carry: this tick gets inc + 1
+    nco_acc = acc;
+    if (up != nco_up) {
+        nco_up = up;
+        nco_write(nco_inc + up);
+    }
+}
+
+void clock_isr(void) {
+    uint8_t overflow = PIR3bits.TMR3IF;
+
+    if (PIE4bits.CCP2IE && PIR4bits.CCP2IF) {
+        PIR4bits.CCP2IF = 0;
+
+        // A pending overflow happened before this match if the match
+        // value is in the lower half of the TMR3 range
+        uint16_t hi = soft_hi;
+        if (overflow && CCPR2H < 0x80) {
+            hi++;
+        }
+
+        if (hi == (uint16_t)(soft_next >> 16)) {
+            LATBbits.LATB6 ^= 1;
+            if (LATBbits.LATB6 && glide_edge) {
+                glide_to_nco();
+            } else if (LATBbits.LATB6 && staged && active_mode == CLOCK_RUN) {
+                staged_at_edge();
+            }
+            // Stop high after the last counted cycle, or after SYNC
+            if (LATBbits.LATB6 && (soft_burst != 0 ? --soft_burst == 0
+                                                   : soft_sync && clc_gate_done())) {
+                soft_stop();
+            }
+            soft_next += soft_half;
+            CCPR2H = (uint8_t)(soft_next >> 8);
+            CCPR2L = (uint8_t)soft_next;
+        }
+    }
+
+    if (overflow) {
+        PIR3bits.TMR3IF = 0;
+        soft_hi++;
+    }
+}
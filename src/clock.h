@@ -0,0 +1,246 @@
+/**
+ * Clock Output Engine for PIC16F18346
+ *
+ * Owns RB6 and everything that drives it:
+ *   - NCO1 in FDC mode for 12 Hz to 1 MHz (hardware, zero CPU)
+ *   - Software clock for 1 Hz to 11 Hz: TMR3 free-running at Fosc/4 with
+ *     CCP2 compare interrupts toggling RB6. Each edge is scheduled from
+ *     the previous one, so the period does not drift with ISR latency.
+ *   - Step mode pulses (step_pulse.h, CCP3 on the same TMR3)
+ *   - Bursts of N cycles, runs to an absolute cycle number and runs to
+ *     the target's next SYNC edge, gated in hardware (clc_gate.h) in NCO
+ *     mode and stopped by the software clock ISR below 12 Hz
+ *   - CWG two-phase and CLC ÷2 outputs, which follow NCO1
+ *   - Glide: run-mode retunes slewed toward the new frequency on the
+ *     1 ms tick instead of loaded at once (clock_glide)
+ *   - Dithering: the fraction of an NCO increment left by the crystal
+ *     correction (cal.h, with its temperature and reference terms) and
+ *     the fine tune is dithered on the 1 ms tick (clock_tick) by one
+ *     first-order 16-bit accumulator: each tick loads inc or inc + 1, so
+ *     the mean is exact to 1/65536 increment and within 1/1000 increment
+ *     over any second. Nothing is dithered while a glide runs (its ramp
+ *     owns the increment) or on the software clock, whose half periods
+ *     move in 4-cycle steps.
+ *
+ * Frequencies are passed as freq_table entries (bit 31 = software mode).
+ */
+
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <xc.h>
+#include <stdint.h>
+
+/* Output modes */
+#define CLOCK_RUN       0   /* Continuous clock at the active entry */
+#define CLOCK_STEP      1   /* RB6 idle high, pulses from step_pulse.h */
+#define CLOCK_HALT      2   /* RB6 held high (parked by HALT_SEL in hardware) */
+#define CLOCK_BURST     3   /* RB6 idle high, N cycles from clock_burst */
+#define CLOCK_COUNT     4   /* RB6 idle high, runs to a cycle (clock_run_to) */
+#define CLOCK_ISTEP     5   /* RB6 idle high, runs to SYNC (clock_step_sync) */
+
+/* Glide flags (clock_glide) */
+#define CLOCK_GLIDE_CYCLE   0x01    /* Rate in 0.01 % per cycle, else 0.1 octave/s */
+#define CLOCK_GLIDE_START   0x02    /* Soft start: ramp up at power-up */
+#define CLOCK_GLIDE_MIN     5       /* 0.5 octave/s, 0.05 % per cycle */
+#define CLOCK_GLIDE_MAX     1000    /* 100 octaves/s, 10 % per cycle */
+
+/**
+ * Configure the CLC1 gate, NCO1, CWG1, CLC4, the software clock timer
+ * and the step pulse generator, then start in `mode` (CLOCK_*) at the
+ * given freq_table entry and fine tune (ppm, see clock_retune_fine).
+ * Modes other than run start parked, so RB6 never shows a cycle of a
+ * mode it does not start in.
+ */
+void clock_init(uint32_t entry, int16_t fine, uint8_t mode);
+
+/**
+ * Select a new frequency. In run mode it takes effect immediately (NCO)
+ * or at the next edge (software clock), or is glided to (clock_glide);
+ * otherwise it is stored and used when run mode resumes or the next
+ * burst starts.
+ */
+void clock_retune(uint32_t entry);
+
+/**
+ * clock_retune that never glides, for the table self test (measured at
+ * once). Ends a glide in progress at the new entry.
+ */
+void clock_retune_exact(uint32_t entry);
+
+/**
+ * Stage a stream record's entry (stream.c) to start at the RB6 rising
+ * edge where TMR1 reaches `edge`. It is converted now, so loading it is
+ * register writes only: on the software clock the clock ISR loads it at
+ * that edge, before the next one is scheduled; on the NCO the boundary
+ * interrupt calls clock_load_staged. Call from the ISR or with
+ * interrupts off. A retune replaces it.
+ */
+void clock_stage(uint32_t entry, uint16_t edge);
+
+/**
+ * Load the staged entry now if the clock ISR has not loaded it at its
+ * edge, ending a glide. Returns nonzero if it was loaded here. Outside
+ * run mode it only becomes the active entry.
+ */
+uint8_t clock_load_staged(void);
+
+/**
+ * Drop a staged entry (the stream stopped).
+ */
+void clock_unstage(void);
+
+/**
+ * clock_retune with the entry moved by `ppm` (fine tune, fine.h): the
+ * NCO keeps the fraction of an increment and dithers it on the 1 ms
+ * tick, software half periods move in 4-cycle steps. clock_retune is the
+ * same with 0, so a sweep or stream drops the offset.
+ */
+void clock_retune_fine(uint32_t entry, int16_t ppm);
+
+/**
+ * Switch between the CLOCK_* modes. Entering halt, burst or count mode
+ * from run mode finishes the current cycle first (unless a stream is
+ * running); count mode starts at cycle 0. Instruction step mode runs on
+ * to the next SYNC edge.
+ */
+void clock_set_mode(uint8_t mode);
+
+/**
+ * Apply the active entry again, e.g. after the crystal correction
+ * changed (cal.h): loaded at once (a correction of a few ppm is not
+ * glided), or the new target of a glide under way. Safe against
+ * retunes from the ISR. Run mode only; other modes pick it up when they
+ * next start.
+ */
+void clock_reapply(void);
+
+/**
+ * Slew limit for run-mode retunes: `rate` CLOCK_GLIDE_MIN..MAX in 0.1
+ * octave/s, or with CLOCK_GLIDE_CYCLE in 0.01 % per cycle; 0 turns the
+ * glide off (a glide in progress ends at its target). CLOCK_GLIDE_START,
+ * set before clock_init, starts run mode at power-up on the software
+ * clock at 11.44 Hz and glides up to the entry. Returns 0, changing
+ * nothing, if `rate` is out of range.
+ *
+ * The tick moves the increment (or software half period) toward the
+ * target by a fixed ratio and stops exactly on it, never past it; each
+ * step is a double-buffered increment write or takes effect from the
+ * next software edge, so the output stays phase continuous. In octaves
+ * per second the ratio per tick is rate × ln 2 / 10000 (at most the
+ * rate); per cycle it is the percentage times the output cycles in a
+ * tick (f / 1 kHz), added rather than compounded and at most ×1.5, so
+ * a glide per cycle is never faster than its rate and slower where a
+ * tick holds many cycles. A step is never smaller than
+ * one increment or 4 software clock cycles. Below 2 kHz the ramp runs on
+ * the software clock; the NCO takes over at a rising edge with its phase
+ * cleared, and hands back while RB6 is high with the falling edge where
+ * its accumulator would have overflowed, so no half period is cut short.
+ */
+uint8_t clock_glide(uint16_t rate, uint8_t flags);
+
+/**
+ * Nonzero while a glide is moving toward its target.
+ */
+uint8_t clock_gliding(void);
+
+/**
+ * 1 ms tick (TMR0 ISR): steps a glide, or else dithers the fraction of
+ * an NCO increment left by the crystal correction and the fine tune.
+ * Returns at once when there is neither.
+ */
+void clock_tick(void);
+
+/**
+ * NCO increment loaded for the active entry (crystal correction and fine
+ * tune applied, before dithering and spreading), 0 for the software
+ * clock.
+ */
+uint32_t clock_nco_inc(void);
+
+/**
+ * Spread-spectrum offset added to the NCO increment from now on
+ * (spread.h), loaded at once. Call from the ISR or with interrupts off.
+ */
+void clock_spread(int16_t offset);
+
+/**
+ * Free-running TMR3 time (Fosc/4, 6 counts/µs) extended to 32 bits, the
+ * software clock's timeline. Call with interrupts off (e.g. from the ISR).
+ */
+uint32_t clock_time(void);
+
+/**
+ * Run mode: keep the hardware halt watch (clc_gate.h) armed while `allow`
+ * is nonzero and the NCO drives RB6; disarm it otherwise. Call from the
+ * switch poll with allow = no stream or playlist running. Re-arms after a
+ * halt shorter than one poll.
+ */
+void clock_halt_watch(uint8_t allow);
+
+/**
+ * Hand TMR1/CCP1 back to the stream engine before it starts. A halt
+ * parked by the gate is taken over by RB6 as GPIO, still high.
+ */
+void clock_release_counter(void);
+
+/**
+ * Current output mode.
+ */
+uint8_t clock_mode(void);
+
+/**
+ * Active freq_table entry.
+ */
+uint32_t clock_entry(void);
+
+/**
+ * Fine tune applied to it, ppm.
+ */
+int16_t clock_fine(void);
+
+/**
+ * Burst mode: output exactly `cycles` full cycles (1..65535) at the
+ * active entry, starting with a full low half period and ending high.
+ * Returns 0 if not in burst mode or the previous burst is still running.
+ */
+uint8_t clock_burst(uint16_t cycles);
+
+/**
+ * Count mode: run from the current cycle number to `cycle` (up to
+ * 2^32-1) and park high just after that cycle ends. Every run starts
+ * with a full low half period. Returns 0 if not in count mode, `cycle`
+ * is not ahead of the current one, or a run is still going.
+ */
+uint8_t clock_run_to(uint32_t cycle);
+
+/**
+ * Instruction step mode: run at the active entry from the parked state
+ * until the next rising edge on SYNC (RC1), then park high before the
+ * following falling edge. Returns 0 if not in that mode or still running.
+ */
+uint8_t clock_step_sync(void);
+
+/**
+ * Nonzero in the modes that use TMR1/CCP1 for a counted stop (burst,
+ * count, instruction step); the stream engine cannot run in them.
+ */
+uint8_t clock_counting(void);
+
+/**
+ * Count mode: cycles output since the mode was entered.
+ */
+uint32_t clock_cycle(void);
+
+/**
+ * Count mode: cycle at which the current (or last) run stops.
+ */
+uint32_t clock_target(void);
+
+/**
+ * Software clock interrupt handler (TMR3 overflow, CCP2 compare).
+ * Call from the ISR on every interrupt; it checks its own flags.
+ */
+void clock_isr(void);
+
+#endif /* CLOCK_H */
@@ -0,0 +1,1453 @@
+/**
+ * Serial Command Interface
+ *
+ * Timing (cmd task released every 2 ms, see main.c):
+ *   Latency: a command is executed at most 2 ms after its line ending is
+ *   received, plus its own run time (the "cmd" WCET reported by T). F
+ *   retunes the output within that run; M and P are picked up by the
+ *   switch (10 ms) and retune (20 ms) tasks.
+ *   Throughput: one line per run, 500 commands/s sustained. Binary stream
+ *   frames (stream.c) are not limited to one per run; every received byte
+ *   of a frame is consumed in the run that sees it. The line itself is
+ *   slower than that for most commands (an F command and its reply take
+ *   ~1.4 ms each way at 115200), so a host that waits for each reply
+ *   never overruns the 32-byte receive ring.
+ *
+ * Decimal output uses repeated subtraction. 32-bit divisions are limited
+ * to the synth_* conversions and a few once-per-command scalings (A, N v,
+ * X, J), which keeps an F command well inside one tick.
+ */
+
+#include "cmd.h"
+#include "uart.h"
+#include "synth.h"
+#include "clock.h"
+#include "sched.h"
+#include "freq_table.h"
+#include "stream.h"
+#include "sweep.h"
+#include "settings.h"
+#include "playlist.h"
+#include "clc_gate.h"
+#include "step_pulse.h"
+#include "cal.h"
+#include "tempco.h"
+#include "fll.h"
+#include "freqmeter.h"
+#include "startup.h"
+#include "potmap.h"
+#include "fine.h"
+#include "preset.h"
+#include "cv.h"
+#include "spread.h"
+
+#define HZ_DIGITS_MAX   7       /* Integer part of F, up to 9,999,999 */
+#define REPORT_FREE     32      /* TX space needed for one report line */
+#define CAL_TIMEOUT     6000    /* Runs (12 s) before a measurement gives up */
+#define METER_GATE_DEF  1000    /* N: gate time in ms */
+#define VERIFY_GATE_MS  100     /* N v: gate per counted (direct) entry */
+#define VERIFY_TOL      50      /* N v: fails above 0.50 % (0.01 % units) */
+
+static char line[CMD_LINE_MAX + 1];
+static uint8_t line_len;
+static uint8_t line_long;       /* Line exceeded CMD_LINE_MAX */
+
+static uint8_t host_mode;
+static uint8_t host_override;
+static uint8_t host_restored;   /* Override is the startup record's */
+static uint32_t host_entry;
+static uint8_t step_request;
+
+static uint8_t report_next;     /* T report: next task + 1, 0 = idle */
+static uint16_t cal_wait;       /* A m: runs left before timeout, 0 = idle */
+static uint8_t meter_wait;      /* N: reply when the measurement ends */
+static uint16_t verify_next;    /* N v: entry being measured + 1, 0 = idle */
+static uint8_t verify_start;    /* N v: entry 0 is started by cmd_task */
+static uint8_t verify_failed;
+static uint16_t verify_worst;   /* 0.01 % */
+
+static void reply_end(void) {
+    uart_puts("\r\n");
+}
+
+static void reply_err(const char *why) {
+    uart_puts("ERR ");
+    uart_puts(why);
+    reply_end();
+}
+
+static char *skip_spaces(char *p) {
+    while (*p == ' ') {
+        p++;
+    }
+    return p;
+}
+
+/* Next space-separated word of *p, terminated in place; NULL at the end */
+static char *next_word(char **p) {
+    char *w = skip_spaces(*p);
+    char *e = w;
+
+    if (*w == '\0') {
+        return 0;
+    }
+    while (*e != ' ' && *e != '\0') {
+        e++;
+    }
+    if (*e != '\0') {
+        *e++ = '\0';
+    }
+    *p = e;
+    return w;
+}
+
+/* Index of word in names[0..n-1], or n if not found */
+static uint8_t keyword(const char *w, const char *const *names, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+        const char *a = w;
+        const char *b = names[i];
+        while (*b && *a == *b) {
+            a++;
+            b++;
+        }
+        if (*a == '\0' && *b == '\0') {
+            return i;
+        }
+    }
+    return n;
+}
+
+/* Decimal word → value; returns 0 on a syntax error or overflow */
+static uint8_t parse_u32(const char *p, uint32_t *value) {
+    uint32_t v = 0;
+
+    if (*p == '\0') {
+        return 0;
+    }
+    while (*p >= '0' && *p <= '9') {
+        uint8_t d = (uint8_t)(*p++ - '0');
+        if (v > 429496729UL || (v == 429496729UL && d > 5)) {
+            return 0;
+        }
+        v = v * 10 + d;
+    }
+    *value = v;
+    return *p == '\0';
+}
+
+static uint8_t parse_u16(const char *p, uint16_t *value) {
+    uint32_t v;
+
+    if (!parse_u32(p, &v) || v > 0xFFFF) {
+        return 0;
+    }
+    *value = (uint16_t)v;
+    return 1;
+}
+
+/* "<hz>[.<mhz>]" → mHz; returns 0 on a syntax error or overflow */
+static uint8_t parse_mhz(const char *p, uint32_t *mhz) {
+    uint32_t hz = 0;
+    uint16_t frac = 0;
+    uint8_t digits = 0;
+
+    while (*p >= '0' && *p <= '9') {
+        if (++digits > HZ_DIGITS_MAX) {
+            return 0;
+        }
+        hz = hz * 10 + (uint8_t)(*p++ - '0');
+    }
+    if (digits == 0 || hz > 4294966UL) {
+        return 0;
+    }
+
+    if (*p == '.') {
+        p++;
+        for (digits = 0; digits < 3; digits++) {
+            frac *= 10;
+            if (*p >= '0' && *p <= '9') {
+                frac += (uint8_t)(*p++ - '0');
+            }
+        }
+    }
+    if (*p != '\0') {
+        return 0;
+    }
+
+    *mhz = hz * 1000 + frac;
+    return 1;
+}
+
+/* "[-]<ppm>[.<fraction>]" → 0.01 ppm within ±CAL_PPM_MAX */
+static uint8_t parse_ppm(const char *p, int16_t *centi) {
+    uint8_t neg = (*p == '-');
+    uint32_t milli;
+
+    if (neg) {
+        p++;
+    }
+    // Same format as a frequency: integer part and three decimals
+    if (!parse_mhz(p, &milli) || milli > CAL_PPM_MAX * 10UL) {
+        return 0;
+    }
+    int16_t v = (int16_t)((milli + 5) / 10);
+    *centi = neg ? -v : v;
+    return 1;
+}
+
+/* "[-]<n>" → int16_t */
+static uint8_t parse_s16(const char *p, int16_t *value) {
+    uint8_t neg = (*p == '-');
+    uint16_t v;
+
+    if (neg) {
+        p++;
+    }
+    if (!parse_u16(p, &v) || v > (neg ? 32768U : 32767U)) {
+        return 0;
+    }
+    *value = neg ? (int16_t)(0 - v) : (int16_t)v;
+    return 1;
+}
+
+/* Indexed by CLOCK_*, SWEEP_LIN/LOG, SWEEP_ONCE/REPEAT/PINGPONG (+ auto)
+ * and FLL_* */
+static const char *const mode_names[] = { "run", "step", "halt", "burst", "count", "istep" };
+static const char *const law_names[] = { "lin", "log", "knee" };
+static const char *const repeat_names[] = { "once", "repeat", "ping", "auto" };
+static const char *const startup_names[] = { "last", "pin", "pot" };
+static const char *const meter_names[] = { "int", "ext", "v" };
+static const char *const fll_names[] = { "off", "acquire", "locked", "holdover" };
+static const char *const spread_names[] = { "tri", "kiss" };
+static const char *const glide_names[] = { "oct", "%", "start" };
+static const char *const list_words[] = { "play", "loop", "once", "trig", "manual", "end" };
+static const char *const onoff_names[] = { "off", "on", "auto" };   /* E, V, X, J */
+
+/* Stop whatever currently controls the frequency from the host side */
+static void release_frequency(void) {
+    stream_stop();
+    sweep_stop();
+    cv_stop();
+    fine_set(0);                /* A new setting starts untuned */
+}
+
+static void reply_ok(void) {
+    uart_puts("OK");
+    reply_end();
+}
+
+static void cmd_frequency(char *arg) {
+    uint32_t mhz;
+    char *w = next_word(&arg);
+    if (w == 0 || next_word(&arg) != 0 || !parse_mhz(w, &mhz)) {
+        reply_err("syntax");
+        return;
+    }
+
+    uint32_t entry = synth_solve(mhz);
+    if (entry == SYNTH_INVALID) {
+        reply_err("range");
+        return;
+    }
+
+    release_frequency();
+    host_entry = entry;
+    host_override = 1;
+    host_restored = 0;
+    clock_retune(entry);        /* Stored only if not running */
+
+    uart_puts("OK ");
+    uart_putdec(synth_mhz(entry), 3);
+    reply_end();
+}
+
+static void cmd_mode_set(char *arg) {
+    char *w = next_word(&arg);
+    uint8_t m = w ? keyword(w, mode_names, 6) : 6;
+
+    if (m == 6 || next_word(&arg) != 0) {
+        reply_err("mode");
+        return;
+    }
+    host_mode = m;
+    reply_ok();
+}
+
+/*
+ * W                                          Run the configured sweep
+ * W <start> <stop> <ms> lin|log [once|repeat|ping] [auto]
+ *                                            Configure and run
+ */
+static void cmd_sweep(char *arg) {
+    sweep_config_t *cfg = &settings_get()->sweep;
+    sweep_config_t c = *cfg;
+    char *w = next_word(&arg);
+
+    if (w != 0) {
+        char *stop = next_word(&arg);
+        char *ms = next_word(&arg);
+        char *law = next_word(&arg);
+        if (stop == 0 || law == 0 ||
+            !parse_mhz(w, &c.start_mhz) || !parse_mhz(stop, &c.stop_mhz) ||
+            !parse_u16(ms, &c.ms)) {
+            reply_err("syntax");
+            return;
+        }
+        c.law = keyword(law, law_names, 2);
+        c.repeat = SWEEP_ONCE;
+        c.flags = 0;
+        while ((w = next_word(&arg)) != 0) {
+            uint8_t r = keyword(w, repeat_names, 4);
+            if (r == 3) {
+                c.flags |= SWEEP_AUTO;
+            } else if (r < 3) {
+                c.repeat = r;
+            } else {
+                c.law = 2;              /* Unknown word */
+            }
+        }
+        if (c.law > SWEEP_LOG) {
+            reply_err("syntax");
+            return;
+        }
+    }
+
+    release_frequency();
+    if (!sweep_start(&c)) {
+        reply_err("range");
+        return;
+    }
+    *cfg = c;
+    reply_ok();
+}
+
+/*
+ * L                            Count, capacity, flags, minimum step
+ * L <i> <hz>[.<mhz>] <cycles>  Store step i
+ * L <i> end                    End the list before step i
+ * L play|loop|once|trig|manual
+ */
+static void cmd_playlist(char *arg) {
+    settings_t *s = settings_get();
+    char *w = next_word(&arg);
+
+    if (w == 0) {
+        uart_puts("OK ");
+        uart_putdec(playlist_count(), 0);
+        uart_putc(' ');
+        uart_putdec(PLAYLIST_MAX, 0);
+        uart_puts((s->playlist & PLAYLIST_LOOP) ? " loop " : " once ");
+        uart_puts((s->playlist & PLAYLIST_TRIGGER) ? "trig " : "manual ");
+        uart_putdec(2 * sched_isr_wcet_us(), 0);     /* Cycles at 1 MHz */
+        uart_putc(' ');
+        uart_putdec(STREAM_AVG_STEP_US, 0);         /* Average, likewise */
+        reply_end();
+        return;
+    }
+
+    if (w[0] >= '0' && w[0] <= '9') {
+        uint16_t i;
+        uint32_t mhz;
+        stream_rec_t r;
+        char *f = next_word(&arg);
+        char *n = next_word(&arg);
+
+        if (!parse_u16(w, &i) || f == 0 || next_word(&arg) != 0) {
+            reply_err("syntax");
+        } else if (stream_playing()) {
+            reply_err("busy");
+        } else if (n == 0 && keyword(f, list_words, 6) == 5) {
+            if (i < PLAYLIST_MAX && playlist_truncate((uint8_t)i)) {
+                reply_ok();
+            } else {
+                reply_err("range");
+            }
+        } else if (n == 0 || !parse_mhz(f, &mhz) || !parse_u16(n, &r.cycles)) {
+            reply_err("syntax");
+        } else {
+            r.entry = synth_solve(mhz);
+            if (r.entry == SYNTH_INVALID || i >= PLAYLIST_MAX || !playlist_set((uint8_t)i, &r)) {
+                reply_err("range");
+                return;
+            }
+            uart_puts("OK ");
+            uart_putdec(synth_mhz(r.entry), 3);
+            reply_end();
+        }
+        return;
+    }
+
+    switch (keyword(w, list_words, 5)) {
+        case 0:
+            if (playlist_count() == 0) {
+                reply_err("empty");
+                return;
+            }
+            if (clock_counting()) {
+                reply_err("mode");
+                return;
+            }
+            release_frequency();
+            stream_play();
+            break;
+        case 1:
+            s->playlist |= PLAYLIST_LOOP;
+            break;
+        case 2:
+            s->playlist &= ~PLAYLIST_LOOP;
+            break;
+        case 3:
+            s->playlist |= PLAYLIST_TRIGGER;
+            break;
+        case 4:
+            s->playlist &= ~PLAYLIST_TRIGGER;
+            break;
+        default:
+            reply_err("syntax");
+            return;
+    }
+    reply_ok();
+}
+
+/*
+ * B          Burst length: "OK <cycles>"
+ * B <cycles> Set it (1..65535, saved by C)
+ */
+static void cmd_burst(char *arg) {
+    uint16_t n;
+    char *w = next_word(&arg);
+
+    if (w != 0) {
+        if (next_word(&arg) != 0 || !parse_u16(w, &n)) {
+            reply_err("syntax");
+            return;
+        }
+        if (n == 0) {
+            reply_err("range");
+            return;
+        }
+        settings_get()->burst = n;
+    }
+    uart_puts("OK ");
+    uart_putdec(settings_get()->burst, 0);
+    reply_end();
+}
+
+/*
+ * R                 Step pulse: "OK <width µs> <repeat ms>"
+ * R <width> [<ms>]  Set the width (100..10000 µs) and auto-repeat
+ *                   period (0 = off, else 20..65535 ms), saved by C
+ */
+static void cmd_step_pulse(char *arg) {
+    settings_t *s = settings_get();
+    uint16_t width;
+    uint16_t repeat = s->step_repeat;
+    char *w = next_word(&arg);
+
+    if (w != 0) {
+        char *r = next_word(&arg);
+        if (next_word(&arg) != 0 || !parse_u16(w, &width) ||
+            (r != 0 && !parse_u16(r, &repeat))) {
+            reply_err("syntax");
+            return;
+        }
+        if (width < STEP_PULSE_WIDTH_MIN || width > STEP_PULSE_WIDTH_MAX ||
+            (repeat != 0 && repeat < STEP_PULSE_REPEAT_MIN)) {
+            reply_err("range");
+            return;
+        }
+        s->step_width = width;
+        s->step_repeat = repeat;
+        step_pulse_config(width, repeat);
+    }
+    uart_puts("OK ");
+    uart_putdec(s->step_width, 0);
+    uart_putc(' ');
+    uart_putdec(s->step_repeat, 0);
+    reply_end();
+}
+
+static void put_ppm(int16_t centi) {
+    if (centi < 0) {
+        uart_putc('-');
+        centi = -centi;
+    }
+    uart_putdec((uint16_t)centi, 2);
+}
+
+/* Fine tune in whole ppm, always signed */
+static void put_fine(int16_t ppm) {
+    uart_putc(ppm < 0 ? '-' : '+');
+    uart_putdec((uint16_t)(ppm < 0 ? -ppm : ppm), 0);
+}
+
+static void reply_ppm(int16_t centi) {
+    uart_puts("OK ");
+    put_ppm(centi);
+    reply_end();
+}
+
+/*
+ * A            Stored crystal correction in ppm: "OK <ppm>"
+ * A <ppm>      Set it (±200.00, positive = crystal fast, saved by C);
+ *              the temperature curve (Y) is added to it
+ * A m <hz>     Measure against a <hz> reference on RC1 and store the
+ *              result less the curve term now: "OK <ppm>" (measured)
+ *              about 4 s later (1 PPS: 6 s)
+ */
+static void cmd_cal(char *arg) {
+    int16_t centi;
+    uint16_t hz;
+    char *w = next_word(&arg);
+
+    if (w == 0) {
+        reply_ppm(settings_get()->cal);
+        return;
+    }
+    if (w[0] == 'm' && w[1] == '\0') {
+        w = next_word(&arg);
+        if (w == 0 || next_word(&arg) != 0 || !parse_u16(w, &hz)) {
+            reply_err("syntax");
+            return;
+        }
+        if (clock_counting() || stream_active()) {
+            reply_err("mode");
+            return;
+        }
+        clock_release_counter();        /* Halt watch off, TMR1 ours */
+        if (!cal_start(hz)) {
+            reply_err("range");
+            return;
+        }
+        cal_wait = CAL_TIMEOUT;
+        return;                         /* Reply when it finishes */
+    }
+    if (next_word(&arg) != 0 || !parse_ppm(w, &centi)) {
+        reply_err("syntax");
+        return;
+    }
+    settings_get()->cal = centi;
+    tempco_apply();
+    reply_ppm(centi);
+}
+
+/* Finish an A m measurement: apply the result or report the failure */
+static void cal_finish(void) {
+    int16_t centi;
+
+    if (cal_busy()) {
+        if (--cal_wait != 0) {
+            return;
+        }
+        cal_abort();
+        cal_wait = 0;
+        reply_err("timeout");
+        return;
+    }
+    cal_wait = 0;
+    if (!cal_result(&centi)) {
+        reply_err("range");
+        return;
+    }
+    int32_t base = (int32_t)centi - tempco_curve();
+    if (base > CAL_PPM_MAX) {
+        base = CAL_PPM_MAX;
+    } else if (base < -CAL_PPM_MAX) {
+        base = -CAL_PPM_MAX;
+    }
+    settings_get()->cal = (int16_t)base;
+    tempco_apply();
+    reply_ppm(centi);
+}
+
+/*
+ * Y                       Temperature: "OK <code> <applied ppm>"
+ * Y <ref> <c1> <c2> <c3>  Set the curve (tempco.h; saved by C), same reply
+ */
+static void cmd_tempco(char *arg) {
+    settings_t *s = settings_get();
+    char *w = next_word(&arg);
+
+    if (w != 0) {
+        uint16_t ref;
+        int16_t c[3];
+        uint8_t i;
+
+        if (!parse_u16(w, &ref) || ref > 1023) {
+            reply_err("syntax");
+            return;
+        }
+        for (i = 0; i < 3; i++) {
+            w = next_word(&arg);
+            if (w == 0 || !parse_s16(w, &c[i])) {
+                reply_err("syntax");
+                return;
+            }
+        }
+        if (next_word(&arg) != 0) {
+            reply_err("syntax");
+            return;
+        }
+        s->tc_ref = ref;
+        s->tc_c1 = c[0];
+        s->tc_c2 = c[1];
+        s->tc_c3 = c[2];
+        tempco_apply();
+    }
+
+    uart_puts("OK ");
+    uart_putdec(tempco_code(), 0);
+    uart_putc(' ');
+    put_ppm(cal_get());
+    reply_end();
+}
+
+/*
+ * D          Discipline: "OK <state> <ppm> <residual ppm> <age s>"
+ * D <hz>     Lock to a <hz> reference on RA2 (1 PPS: 1), same reply
+ * D off      Stop; the stored correction applies again
+ */
+static void cmd_discipline(char *arg) {
+    char *w = next_word(&arg);
+    uint16_t hz;
+
+    if (w != 0) {
+        if (next_word(&arg) != 0) {
+            reply_err("syntax");
+            return;
+        }
+        if (keyword(w, fll_names, 1) == FLL_OFF) {
+            fll_stop();
+        } else if (!parse_u16(w, &hz)) {
+            reply_err("syntax");
+            return;
+        } else if (!fll_start(hz)) {
+            reply_err("range");
+            return;
+        }
+    }
+    uart_puts("OK ");
+    uart_puts(fll_names[fll_state()]);
+    uart_putc(' ');
+    put_ppm(fll_ppm());
+    uart_putc(' ');
+    put_ppm(fll_residual());
+    uart_putc(' ');
+    uart_putdec(fll_age(), 0);
+    reply_end();
+}
+
+/* TMR1 for the meter: same conditions as A m */
+static uint8_t meter_claim(void) {
+    if (clock_counting() || stream_active() || cal_busy()) {
+        reply_err("mode");
+        return 0;
+    }
+    clock_release_counter();        /* Halt watch off, TMR1 ours */
+    return 1;
+}
+
+static void put_hz(const meter_result_t *r) {
+    uart_putdec(r->hz, 0);
+    uart_putc('.');
+    uart_putc((char)('0' + r->milli / 100));
+    uart_putc((char)('0' + r->milli / 10 % 10));
+    uart_putc((char)('0' + r->milli % 10));
+}
+
+/*
+ * N v checks every entry against synth_mhz. VERIFY_TOL is a gross-error
+ * threshold (wrong table value, clock or mode), not the table's accuracy,
+ * and each entry is measured well inside it:
+ *
+ *   - Below METER_RECIP_HZ (all software clock entries, 1-11 Hz, and the
+ *     NCO to 10 kHz) the meter times whole periods to 41.7 ns, at least
+ *     one period after its probe whatever the gate, so a 1 Hz entry is
+ *     one period timed to 0.04 ppm (about 3 s with the probe), not the
+ *     0-1 edges a 100 ms count would see. The gate is METER_GATE_MIN
+ *     there: a longer one only adds periods.
+ *   - From METER_RECIP_HZ it counts edges for half of VERIFY_GATE_MS, to
+ *     about ±1 count: 0.2 % at 10 kHz, less above.
+ */
+static uint16_t verify_gate(uint32_t entry) {
+    if (synth_mhz(entry) < METER_RECIP_HZ * 1000UL) {
+        return METER_GATE_MIN;
+    }
+    return VERIFY_GATE_MS;
+}
+
+/* Measure the next table entry, or report and finish */
+static void verify_entry(uint16_t i) {
+    if (i == 256) {
+        uart_puts("OK ");
+        uart_putdec(verify_failed, 0);
+        uart_putc(' ');
+        uart_putdec(verify_worst, 2);
+        reply_end();
+        host_override = 0;      /* Back to the pot */
+        verify_next = 0;
+        return;
+    }
+    if (clock_mode() != CLOCK_RUN) {
+        reply_err("mode");
+    }
+    if (clock_mode() != CLOCK_RUN || !meter_claim()) {
+        host_override = 0;
+        verify_next = 0;
+        return;
+    }
+    host_entry = freq_table[i];
+    host_override = 1;
+    clock_retune_exact(host_entry); /* Measured at once, so no glide */
+    meter_start(METER_INT, verify_gate(host_entry));
+    verify_next = i + 1;
+}
+
+/*
+ * Check the entry just measured against its nominal frequency. Returns 0
+ * while it is still being measured, else cmd_task starts the next one.
+ */
+static uint8_t verify_step(void) {
+    meter_result_t r;
+
+    if (meter_busy() || uart_tx_free() < REPORT_FREE) {
+        return 0;
+    }
+    uint16_t i = verify_next - 1;
+    uint32_t expect = synth_mhz(freq_table[i]);
+    uint32_t got = meter_result(&r) ? r.hz * 1000UL + r.milli : 0;
+    uint32_t dev = got > expect ? got - expect : expect - got;
+
+    if (dev > 40000000UL) {
+        dev = 40000000UL;       /* Saturates the percentage below */
+    }
+    uint32_t pct = dev * 100 / (expect / 100);
+    if (pct > 0xFFFF) {
+        pct = 0xFFFF;
+    }
+    if (pct > verify_worst) {
+        verify_worst = (uint16_t)pct;
+    }
+    if (pct > VERIFY_TOL) {
+        verify_failed++;
+        uart_puts("V ");
+        uart_putdec(i, 0);
+        uart_putc(' ');
+        uart_putdec(expect, 3);
+        uart_putc(' ');
+        uart_putdec(got, 3);
+        reply_end();
+    }
+    return 1;
+}
+
+/*
+ * N [int|ext] [<ms>]  Measure RB6 (int, default) or RC1 (ext) over a gate
+ *                     of <ms> (10..10000, default 1000): "OK <hz> recip"
+ *                     or "OK <hz> direct" when done
+ * N v                 Verify every freq_table entry on RB6 (run mode): a
+ *                     "V <index> <expected> <measured>" line per entry
+ *                     more than 0.5 % off, then "OK <failed> <worst %>"
+ */
+static void cmd_meter(char *arg) {
+    uint8_t src = METER_INT;
+    uint16_t gate = METER_GATE_DEF;
+    char *w = next_word(&arg);
+
+    if (w != 0) {
+        uint8_t k = keyword(w, meter_names, 3);
+        if (k == 2) {
+            if (next_word(&arg) != 0) {
+                reply_err("syntax");
+                return;
+            }
+            cmd_verify();
+            return;
+        }
+        if (k < 2) {
+            src = k;
+            w = next_word(&arg);
+        }
+    }
+    if (w != 0 && (next_word(&arg) != 0 || !parse_u16(w, &gate))) {
+        reply_err("syntax");
+        return;
+    }
+    if (gate < METER_GATE_MIN || gate > METER_GATE_MAX) {
+        reply_err("range");
+        return;
+    }
+    if (!meter_claim()) {
+        return;
+    }
+    meter_start(src, gate);
+    meter_wait = 1;                 /* Reply when it finishes */
+}
+
+/* Reply to N once the measurement has ended */
+static void meter_finish(void) {
+    meter_result_t r;
+
+    if (meter_busy()) {
+        return;
+    }
+    meter_wait = 0;
+    if (!meter_result(&r)) {
+        reply_err("signal");
+        return;
+    }
+    uart_puts("OK ");
+    put_hz(&r);
+    uart_puts(r.direct ? " direct" : " recip");
+    reply_end();
+}
+
+/*
+ * G                          Pot range: "OK <n> <law> <lo> [<knee>] <hi>"
+ * G <n>                      Select range n (0 table, 1 audio, 2 top
+ *                            decade, 3 custom)
+ * G lin|log <lo> <hi>        Set the custom range and select it
+ * G knee <lo> <knee> <hi>    Custom: half the travel to the knee, log
+ * Stored by C.
+ */
+static void cmd_range(char *arg) {
+    settings_t *s = settings_get();
+    potmap_range_t r;
+    char *w = next_word(&arg);
+
+    if (w != 0 && w[0] >= '0' && w[0] <= '9') {
+        uint16_t n;
+        if (!parse_u16(w, &n) || n >= POTMAP_RANGES || next_word(&arg) != 0) {
+            reply_err("syntax");
+            return;
+        }
+        if (!potmap_select((uint8_t)n)) {
+            reply_err("range");
+            return;
+        }
+        preset_map();
+        s->pot_range = (uint8_t)n;
+    } else if (w != 0) {
+        char *lo = next_word(&arg);
+        char *knee = next_word(&arg);
+        char *hi = next_word(&arg);
+        potmap_range_t old = s->pot_custom;
+
+        r.law = keyword(w, law_names, 3);
+        r.knee_mhz = 0;
+        if (r.law != POTMAP_KNEE) {
+            hi = knee;
+            knee = 0;
+        }
+        if (r.law > POTMAP_KNEE || hi == 0 || next_word(&arg) != 0 ||
+            !parse_mhz(lo, &r.lo_mhz) || !parse_mhz(hi, &r.hi_mhz) ||
+            (knee != 0 && !parse_mhz(knee, &r.knee_mhz))) {
+            reply_err("syntax");
+            return;
+        }
+        s->pot_custom = r;
+        if (!potmap_select(POTMAP_CUSTOM)) {
+            s->pot_custom = old;
+            reply_err("range");
+            return;
+        }
+        s->pot_range = POTMAP_CUSTOM;
+        preset_map();
+    }
+
+    potmap_get(s->pot_range, &r);
+    uart_puts("OK ");
+    uart_putdec(s->pot_range, 0);
+    uart_putc(' ');
+    uart_puts(law_names[r.law]);
+    uart_putc(' ');
+    uart_putdec(r.lo_mhz, 3);
+    if (r.law == POTMAP_KNEE) {
+        uart_putc(' ');
+        uart_putdec(r.knee_mhz, 3);
+    }
+    uart_putc(' ');
+    uart_putdec(r.hi_mhz, 3);
+    reply_end();
+}
+
+/*
+ * V          CV mode: "OK off", or "OK on <CV mV> <hz>"
+ * V on       Follow the CV on RA1 from the pot's frequency, 1 V/octave
+ * V on auto  Also at power-up (saved by C)
+ * V off      Back to the pot or host frequency
+ */
+static void cmd_cv(char *arg) {
+    char *w = next_word(&arg);
+    char *a = next_word(&arg);
+    settings_t *s = settings_get();
+
+    if (w != 0) {
+        uint8_t on = keyword(w, onoff_names, 2);
+        if (on == 2 || next_word(&arg) != 0 ||
+            (a != 0 && (!on || keyword(a, onoff_names, 3) != 2))) {
+            reply_err("syntax");
+            return;
+        }
+        s->cv = (a != 0) ? CV_AUTO : 0;
+        release_frequency();
+        if (on) {
+            cv_start();
+        }
+    }
+    if (!cv_active()) {
+        uart_puts("OK off");
+        reply_end();
+        return;
+    }
+    uart_puts("OK on ");
+    uart_putdec(cv_mv(), 0);
+    uart_putc(' ');
+    uart_putdec(synth_mhz(clock_entry()), 3);
+    reply_end();
+}
+
+/*
+ * X                  Spread spectrum: "OK off" or
+ *                    "OK <±%> <rate Hz> tri|kiss"
+ * X <%> [<hz>] [tri|kiss] [auto]
+ *                    Spread by ±<%> (0.01..3.00) at <hz> (20..500,
+ *                    default the stored rate) with a triangle or kiss
+ *                    profile; auto: also at power-up (saved by C)
+ * X off              Stop
+ */
+static void cmd_spread(char *arg) {
+    char *w = next_word(&arg);
+    settings_t *s = settings_get();
+
+    if (w != 0 && keyword(w, onoff_names, 1) == 0) {
+        if (next_word(&arg) != 0) {
+            reply_err("syntax");
+            return;
+        }
+        spread_stop();
+        s->spread_profile &= (uint8_t)~SPREAD_AUTO;
+    } else if (w != 0) {
+        uint32_t milli;
+        uint16_t rate = s->spread_rate;
+        uint8_t profile = s->spread_profile & (uint8_t)~SPREAD_AUTO;
+        uint8_t flags = 0;
+
+        if (!parse_mhz(w, &milli)) {
+            reply_err("syntax");
+            return;
+        }
+        while ((w = next_word(&arg)) != 0) {
+            uint8_t p = keyword(w, spread_names, SPREAD_PROFILES);
+            if (p < SPREAD_PROFILES) {
+                profile = p;
+            } else if (keyword(w, onoff_names, 3) == 2) {
+                flags = SPREAD_AUTO;
+            } else if (!parse_u16(w, &rate)) {
+                reply_err("syntax");
+                return;
+            }
+        }
+        uint16_t depth = (uint16_t)((milli + 5) / 10);
+        if (milli > SPREAD_DEPTH_MAX * 10UL || !spread_start(depth, rate, profile)) {
+            reply_err("range");
+            return;
+        }
+        s->spread_depth = depth;
+        s->spread_rate = rate;
+        s->spread_profile = profile | flags;
+    }
+    if (!spread_active()) {
+        uart_puts("OK off");
+        reply_end();
+        return;
+    }
+    uart_puts("OK ");
+    uart_putdec(s->spread_depth, 2);
+    uart_putc(' ');
+    uart_putdec(spread_rate(), 3);
+    uart_putc(' ');
+    uart_puts(spread_names[s->spread_profile & (uint8_t)~SPREAD_AUTO]);
+    reply_end();
+}
+
+/*
+ * J                  Glide: "OK off" or "OK <rate> oct|% [start]"
+ * J <rate> oct|% [start]
+ *                    Slew run-mode frequency changes at <rate> octaves/s
+ *                    (0.5..100) or % per cycle (0.05..10); start: also
+ *                    ramp up from 11.44 Hz on the software clock at
+ *                    power-up (saved by C)
+ * J off              Load frequency changes at once again
+ */
+static void cmd_glide(char *arg) {
+    char *w = next_word(&arg);
+    settings_t *s = settings_get();
+
+    if (w != 0 && keyword(w, onoff_names, 1) == 0) {
+        if (next_word(&arg) != 0) {
+            reply_err("syntax");
+            return;
+        }
+        clock_glide(0, 0);
+        s->glide_rate = 0;
+        s->glide_flags = 0;
+    } else if (w != 0) {
+        uint32_t milli;
+        char *u = next_word(&arg);
+        char *a = next_word(&arg);
+        uint8_t unit = (u != 0) ? keyword(u, glide_names, 2) : 2;
+
+        if (!parse_mhz(w, &milli) || unit == 2 || next_word(&arg) != 0 ||
+            (a != 0 && keyword(a, glide_names, 3) != 2)) {
+            reply_err("syntax");
+            return;
+        }
+        uint8_t flags = (unit ? CLOCK_GLIDE_CYCLE : 0) | (a != 0 ? CLOCK_GLIDE_START : 0);
+        uint32_t rate = unit ? (milli + 5) / 10 : (milli + 50) / 100;
+        if (rate == 0 || rate > CLOCK_GLIDE_MAX || !clock_glide((uint16_t)rate, flags)) {
+            reply_err("range");
+            return;
+        }
+        s->glide_rate = (uint16_t)rate;
+        s->glide_flags = flags;
+    }
+    if (s->glide_rate == 0) {
+        uart_puts("OK off");
+        reply_end();
+        return;
+    }
+    uint8_t cycle = s->glide_flags & CLOCK_GLIDE_CYCLE;
+    uart_puts("OK ");
+    uart_putdec(s->glide_rate, cycle ? 2 : 1);
+    uart_putc(' ');
+    uart_puts(glide_names[cycle]);
+    if (s->glide_flags & CLOCK_GLIDE_START) {
+        uart_puts(" start");
+    }
+    reply_end();
+}
+
+/*
+ * E                  Presets: "OK <stored> <capacity> <capture LSB>"
+ * E <i>              Slot i: "OK <hz> <achieved hz> <pot position>|-"
+ * E <i> <hz>[.<mhz>] Store slot i (written to flash at once), same reply
+ * E <i> off          Empty slot i
+ */
+static void cmd_preset(char *arg) {
+    char *w = next_word(&arg);
+    char *f = next_word(&arg);
+    uint16_t i;
+    uint32_t mhz, entry;
+    uint8_t pot;
+
+    if (w == 0) {
+        uint8_t n = 0;
+        for (i = 0; i < PRESET_MAX; i++) {
+            if (preset_get((uint8_t)i) != 0) {
+                n++;
+            }
+        }
+        uart_puts("OK ");
+        uart_putdec(n, 0);
+        uart_putc(' ');
+        uart_putdec(PRESET_MAX, 0);
+        uart_putc(' ');
+        uart_putdec(PRESET_CAPTURE, 0);
+        reply_end();
+        return;
+    }
+    if (!parse_u16(w, &i) || next_word(&arg) != 0) {
+        reply_err("syntax");
+        return;
+    }
+    if (f != 0) {
+        if (keyword(f, onoff_names, 1) == 0) {
+            mhz = 0;
+        } else if (!parse_mhz(f, &mhz)) {
+            reply_err("syntax");
+            return;
+        }
+        if (i >= PRESET_MAX || !preset_set((uint8_t)i, mhz)) {
+            reply_err("range");
+            return;
+        }
+        preset_map();
+    }
+    if (i >= PRESET_MAX) {
+        reply_err("range");
+        return;
+    }
+    mhz = preset_get((uint8_t)i);
+    if (mhz == 0) {
+        uart_puts("OK off");
+        reply_end();
+        return;
+    }
+    entry = synth_solve(mhz);
+    uart_puts("OK ");
+    uart_putdec(mhz, 3);
+    uart_putc(' ');
+    uart_putdec(synth_fine_mhz(entry, synth_exact_ppm(entry, mhz)), 3);
+    uart_putc(' ');
+    if (preset_position((uint8_t)i, &pot)) {
+        uart_putdec(pot, 0);
+    } else {
+        uart_putc('-');
+    }
+    reply_end();
+}
+
+/*
+ * O          Power-up output: "OK last|pin|pot <hz> <mode>" (stored entry
+ *            with its fine tune, and mode; "OK last" alone before the
+ *            first save)
+ * O last     Start at the last-used frequency and mode (default); saved
+ *            10 s after the NCO output last changed
+ * O pin      Start at the current frequency, fine tune and host mode, always
+ * O pot      Start from the pot as read at reset
+ */
+static void cmd_startup(char *arg) {
+    char *w = next_word(&arg);
+    uint32_t entry;
+    uint8_t m;
+    int16_t fine;
+
+    if (w != 0) {
+        uint8_t p = keyword(w, startup_names, 3);
+        if (p == 3 || next_word(&arg) != 0) {
+            reply_err("syntax");
+            return;
+        }
+        if (!startup_save(clock_entry(), host_mode, clock_fine(), p)) {
+            reply_err("write");
+            return;
+        }
+    }
+    uart_puts("OK ");
+    uart_puts(startup_names[startup_policy()]);
+    if (startup_get(&entry, &m, &fine)) {
+        uart_putc(' ');
+        uart_putdec(synth_fine_mhz(entry, fine), 3);
+        uart_putc(' ');
+        uart_puts(mode_names[m]);
+    }
+    reply_end();
+}
+
+/*
+ * K          Count mode position: "OK <cycle> <cycles left>"
+ * K <cycle>  Run to that cycle, then park high
+ */
+static void cmd_count(char *arg) {
+    uint32_t k;
+    char *w = next_word(&arg);
+
+    if (w != 0) {
+        if (next_word(&arg) != 0 || !parse_u32(w, &k)) {
+            reply_err("syntax");
+            return;
+        }
+        if (clock_mode() != CLOCK_COUNT) {
+            reply_err("mode");
+            return;
+        }
+        if (!clock_run_to(k)) {
+            reply_err(k <= clock_cycle() ? "range" : "busy");
+            return;
+        }
+        reply_ok();
+        return;
+    }
+
+    uint32_t now = clock_cycle();
+    uart_puts("OK ");
+    uart_putdec(now, 0);
+    uart_putc(' ');
+    uart_putdec(clock_target() - now, 0);
+    reply_end();
+}
+
+static void cmd_status(void) {
+    uint32_t entry = clock_entry();
+
+    uart_puts("OK ");
+    uart_puts(mode_names[clock_mode()]);
+    uart_puts(stream_playing() ? " list " :
+              stream_active() ? " stream " :
+              sweep_active() ? " sweep " :
+              cv_active() ? " cv " :
+              host_override ? " host " : " pot ");
+    uart_putdec(synth_fine_mhz(entry, clock_fine()), 3);
+    uart_puts(IS_SOFTWARE_MODE(entry) ? " sw " : " nco ");
+    uart_putdec(GET_FREQ_VALUE(entry), 0);
+    if (clock_mode() == CLOCK_BURST) {
+        uart_putc(' ');
+        uart_putdec(settings_get()->burst, 0);
+    } else if (clock_mode() == CLOCK_COUNT) {
+        uart_putc(' ');
+        uart_putdec(clock_cycle(), 0);
+    }
+    if (clock_fine() != 0) {
+        uart_puts(" fine ");
+        put_fine(clock_fine());
+    }
+    if (clc_gate_waiting()) {
+        uart_puts(" wait");
+    }
+    if (spread_active()) {
+        uart_puts(" spread");
+    }
+    if (clock_gliding()) {
+        uart_puts(" glide");
+    }
+    reply_end();
+}
+
+/* One report line per run keeps each run short and the TX ring small */
+static void report_step(void) {
+    if (uart_tx_free() < REPORT_FREE) {
+        return;
+    }
+
+    uint8_t i = report_next - 1;
+    if (i < sched_task_count()) {
+        const sched_task_t *t = sched_task(i);
+        uart_puts(t->name);
+        uart_putc(' ');
+        uart_putdec(t->period, 0);
+        uart_putc(' ');
+        uart_putdec(sched_wcet_us(i), 0);
+        reply_end();
+        report_next++;
+        return;
+    }
+
+    uart_puts("OK ");
+    uart_putdec(sched_overruns(), 0);
+    uart_putc(' ');
+    uart_putdec(uart_rx_lost(), 0);
+    uart_putc(' ');
+    uart_putdec(uart_tx_lost(), 0);
+    uart_putc(' ');
+    uart_putdec(stream_underruns(), 0);
+    uart_putc(' ');
+    uart_putdec(sched_isr_wcet_us(), 0);
+    uart_putc(' ');
+    uart_putdec(startup_time_us(), 0);
+    uart_putc(' ');
+    uart_putdec(stream_lag(), 0);
+    reply_end();
+    report_next = 0;
+}
+
+void cmd_init(void) {
+    line_len = 0;
+    line_long = 0;
+    host_mode = CLOCK_RUN;
+    host_override = 0;
+    host_restored = 0;
+    step_request = 0;
+    cal_wait = 0;
+    meter_wait = 0;
+    verify_next = 0;
+    verify_start = 0;
+    report_next = 0;
+}
+
+void cmd_verify(void) {
+    release_frequency();
+    host_restored = 0;
+    verify_failed = 0;
+    verify_worst = 0;
+    verify_start = 1;
+    verify_next = 1;
+}
+
+void cmd_task(void) {
+    if (report_next != 0) {
+        report_step();
+        return;                 /* Input waits until the report is done */
+    }
+    if (cal_wait != 0) {
+        cal_finish();
+        return;                 /* Input waits for the measurement too */
+    }
+    if (meter_wait) {
+        meter_finish();
+        return;
+    }
+    // Entries start from here, not from a handler or verify_step: the
+    // retune is deep enough (see README, Call depth)
+    if (verify_start) {
+        verify_start = 0;
+        verify_entry(0);
+        return;
+    }
+    if (verify_next != 0) {
+        if (verify_step()) {
+            verify_entry(verify_next);
+        }
+        return;
+    }
+
+    for (;;) {
+        if (!uart_available()) {
+            return;
+        }
+        uint8_t c = uart_getc();
+
+        // Binary frames are consumed as they arrive, between lines only
+        if (stream_rx_busy() || (c == STREAM_SYNC && line_len == 0 && !line_long)) {
+            if (!stream_rx_busy()) {
+                sweep_stop();
+                cv_stop();
+            }
+            stream_rx(c);
+            continue;
+        }
+
+        if (c == '\r' || c == '\n') {
+            if (line_len == 0 && !line_long) {
+                continue;       /* Empty line or second half of CRLF */
+            }
+            line[line_len] = '\0';
+            line_len = 0;
+            if (line_long) {
+                line_long = 0;
+                reply_err("long");
+                return;
+            }
+            break;
+        }
+
+        if (line_len < CMD_LINE_MAX) {
+            if (c >= 'A' && c <= 'Z') {
+                c += 'a' - 'A';
+            }
+            line[line_len++] = (char)c;
+        } else {
+            line_long = 1;
+        }
+    }
+
+    // The line is dispatched here rather than from a helper: a handler
+    // runs one call level below the scheduler (see README, Call depth)
+    char *arg = &line[1];
+
+    switch (line[0]) {
+        case 'f':
+            cmd_frequency(arg);
+            break;
+        case 'm':
+            cmd_mode_set(arg);
+            break;
+        case 's':
+            if (clock_mode() == CLOCK_RUN || clock_mode() == CLOCK_HALT) {
+                reply_err("mode");
+                break;
+            }
+            step_request = 1;
+            reply_ok();
+            break;
+        case 'p':
+            release_frequency();
+            host_override = 0;
+            host_restored = 0;
+            reply_ok();
+            break;
+        case 'w':
+            cmd_sweep(arg);
+            break;
+        case 'l':
+            cmd_playlist(arg);
+            break;
+        case 'b':
+            cmd_burst(arg);
+            break;
+        case 'k':
+            cmd_count(arg);
+            break;
+        case 'r':
+            cmd_step_pulse(arg);
+            break;
+        case 'a':
+            cmd_cal(arg);
+            break;
+        case 'y':
+            cmd_tempco(arg);
+            break;
+        case 'd':
+            cmd_discipline(arg);
+            break;
+        case 'n':
+            cmd_meter(arg);
+            break;
+        case 'o':
+            cmd_startup(arg);
+            break;
+        case 'g':
+            cmd_range(arg);
+            break;
+        case 'e':
+            cmd_preset(arg);
+            break;
+        case 'v':
+            cmd_cv(arg);
+            break;
+        case 'x':
+            cmd_spread(arg);
+            break;
+        case 'j':
+            cmd_glide(arg);
+            break;
+        case 'c':
+            if (settings_save()) {
+                reply_ok();
+            } else {
+                reply_err("write");
+            }
+            break;
+        case '?':
+            cmd_status();
+            break;
+        case 't':
+            report_next = 1;
+            break;
+        default:
+            reply_err("command");
+            break;
+    }
+}
+
+void cmd_restore(uint8_t mode, uint32_t entry) {
+    host_mode = mode;
+    host_entry = entry;
+    host_override = 1;
+    host_restored = 1;
+}
+
+void cmd_pot_moved(void) {
+    if (host_restored) {
+        host_restored = 0;
+        host_override = 0;
+    }
+}
+
+uint8_t cmd_mode(void) {
+    return host_mode;
+}
+
+uint8_t cmd_override(void) {
+    return host_override;
+}
+
+uint32_t cmd_entry(void) {
+    return host_entry;
+}
+
+uint8_t cmd_take_step(void) {
+    uint8_t s = step_request;
+    step_request = 0;
+    return s;
+}
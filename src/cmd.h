@@ -0,0 +1,158 @@
+/**
+ * Serial Command Interface
+ *
+ * Line-oriented, case-insensitive ASCII commands on the UART (115200 8N1).
+ * Each line is terminated by CR or LF and gets exactly one reply line,
+ * "OK ..." or "ERR ...", except T which answers with one line per task:
+ *
+ *   F <hz>[.<mhz>]   Set an exact frequency, 1 Hz to 1 MHz; replies with
+ *                    the frequency actually produced, e.g.
+ *                    "F 32768" → "OK 32764.435"
+ *   M run|step|halt|burst|count|istep
+ *                    Select the output mode (the halt and step switches
+ *                    still take priority)
+ *   S                One step pulse (step mode), burst (burst mode),
+ *                    cycle (count mode) or instruction (istep mode)
+ *   B [<cycles>]     Burst length, 1..65535 cycles (saved by C); replies
+ *                    "OK <cycles>"
+ *   P                Return frequency control to the pot
+ *                    (F and P also end a binary stream or sweep)
+ *   W [<start> <stop> <ms> lin|log [once|repeat|ping] [auto]]
+ *                    Run a sweep, optionally setting its parameters first
+ *                    (auto: also start it at power-up once saved)
+ *   L                Playlist: "OK <steps> <capacity> loop|once trig|manual
+ *                    <minimum step> <minimum average step>", both in
+ *                    cycles at 1 MHz (µs)
+ *   L <i> <hz>[.<mhz>] <cycles>
+ *                    Store playlist step i (written to HEF at once)
+ *   L <i> end        End the playlist before step i
+ *   L play|loop|once|trig|manual
+ *                    Play now, or set end/trigger behaviour (saved by C)
+ *   K [<cycle>]      Count mode: run to that cycle (up to 4294967295) and
+ *                    park high; alone, replies "OK <cycle> <cycles left>"
+ *   R [<width> [<ms>]]
+ *                    Step pulse width (100..10000 µs) and auto-repeat
+ *                    period (0 = off, else 20..65535 ms), saved by C;
+ *                    replies "OK <width µs> <repeat ms>"
+ *   A [<ppm>|m <hz>] Crystal correction: show it, set it (±200.00 ppm,
+ *                    positive = crystal fast, saved by C) or measure it
+ *                    against a <hz> reference on RC1 (about 4 s, 1 PPS:
+ *                    6 s); replies "OK <ppm>"
+ *   Y [<ref> <c1> <c2> <c3>]
+ *                    Temperature compensation curve (tempco.h, saved by
+ *                    C); replies "OK <code> <applied ppm>"
+ *   D [<hz>|off]     Discipline to a <hz> reference on RA2 (1 PPS: 1), or
+ *                    stop; replies "OK <state> <ppm> <residual ppm>
+ *                    <age s>"
+ *   N [int|ext] [<ms>]
+ *                    Measure RB6 (int) or RC1 (ext) over a 10..10000 ms
+ *                    gate: "OK <hz> recip|direct" when done
+ *   N v              Verify every freq_table entry on RB6 (run mode):
+ *                    "V <index> <expected> <measured>" per failing
+ *                    entry, then "OK <failed> <worst %>"
+ *   O [last|pin|pot] Power-up output: the last-used frequency and mode
+ *                    (default), the current one pinned, or the pot at
+ *                    reset; replies "OK last|pin|pot <hz> <mode>"
+ *   G [<n>|lin|log|knee ...]
+ *                    Pot range: select 0..3 (table, audio, top decade,
+ *                    custom) or set the custom one, saved by C; replies
+ *                    "OK <n> <law> <lo> [<knee>] <hi>"
+ *   E [<i> [<hz>|off]]
+ *                    Pot detent presets: list, show slot i, store it
+ *                    (flash at once) or empty it; replies "OK <stored>
+ *                    <capacity> <capture LSB>" or "OK <hz> <achieved hz>
+ *                    <pot position>|-"
+ *   V [on [auto]|off]
+ *                    CV mode: follow 1 V/octave on RA1 from the pot's
+ *                    frequency, auto also at power-up (saved by C);
+ *                    replies "OK off" or "OK on <CV mV> <hz>"
+ *   X [<%> [<hz>] [tri|kiss] [auto]|off]
+ *                    Spread spectrum by ±<%> at <hz>, auto also at
+ *                    power-up (saved by C); replies "OK off" or
+ *                    "OK <±%> <rate Hz> tri|kiss"
+ *   J [<rate> oct|% [start]|off]
+ *                    Glide: slew run-mode retunes at 0.5..100 octaves/s
+ *                    or 0.05..10 % per output cycle, start also from
+ *                    11.44 Hz at power-up (saved by C); replies "OK off"
+ *                    or "OK <rate> oct|% [start]"
+ *   C                Save the settings (sweep, playlist flags, burst) to HEF
+ *   ?                Mode, source (pot/host/sweep/stream/list), actual
+ *                    frequency (with the fine tune) and NCO increment or
+ *                    software half period: "OK run host 32764.435 nco
+ *                    2863", followed in burst mode by the burst length and
+ *                    in count mode by the current cycle; "fine <±ppm>" is
+ *                    appended while SW3 fine tune is applied, "wait"
+ *                    while WAIT is low, "spread" while spreading (X) and
+ *                    "glide" while a glide is under way (J)
+ *   T                Task WCET report, one "name period_ms wcet_us" line
+ *                    per task, then
+ *                    "OK <overruns> <rx lost> <tx lost> <underruns> <isr us>
+ *                    <startup us> <stream lag>", the lag being the most
+ *                    output cycles a stream record's NCO increment was
+ *                    loaded after its boundary
+ *
+ * A STREAM_SYNC byte at the start of a line begins a binary stream frame
+ * instead (see stream.h).
+ *
+ * Parsing runs in cmd_task and handles at most one line per run, so a
+ * command costs one bounded task slot and never delays an output edge.
+ */
+
+#ifndef CMD_H
+#define CMD_H
+
+#include <stdint.h>
+
+#define CMD_LINE_MAX    40      /* Longest accepted line, excluding EOL */
+
+/**
+ * Reset the parser and host overrides (pot control, run mode).
+ */
+void cmd_init(void);
+
+/**
+ * Scheduler task: read received characters and execute at most one
+ * complete line. Never waits for input.
+ */
+void cmd_task(void);
+
+/**
+ * Start an `N v` table verification as if it had been received (the
+ * power-on self test, main.c). Replies over the UART as the command does.
+ */
+void cmd_verify(void);
+
+/**
+ * Start with the startup record's mode and frequency as if set by M and
+ * F (startup.h), until the pot moves.
+ */
+void cmd_restore(uint8_t mode, uint32_t entry);
+
+/**
+ * The pot has moved past the takeover threshold: a restored frequency
+ * gives way to it. Frequencies set by the host are kept.
+ */
+void cmd_pot_moved(void);
+
+/**
+ * Mode requested by the host (CLOCK_*), CLOCK_RUN by default.
+ */
+uint8_t cmd_mode(void);
+
+/**
+ * Nonzero while the host has set a frequency (F) instead of the pot.
+ */
+uint8_t cmd_override(void);
+
+/**
+ * freq_table-format entry set by the host; valid while cmd_override().
+ */
+uint32_t cmd_entry(void);
+
+/**
+ * Nonzero once for each step pulse, burst, cycle or instruction
+ * requested with S.
+ */
+uint8_t cmd_take_step(void);
+
+#endif /* CMD_H */
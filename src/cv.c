@@ -0,0 +1,191 @@
+/**
+ * Control Voltage Input for PIC16F18346
+ *
+ * Register usage while CV mode runs:
+ *
+ *   T2CON  = 0x05     TMR2 on, prescaler 1:4, postscaler 1:1
+ *   PR2    = 249      Fosc/4 / 4 / 250 = 6 kHz
+ *   ADACT  = 0x04     Conversion on TMR2 match (Table 20-2, DS40001800E)
+ *   ADCON0            channel of the next slot, ADON; rewritten in the
+ *                     interrupt right after each result, so the channel
+ *                     acquires for the rest of the 167 µs
+ *   PIE1.ADIE         one interrupt per result
+ *
+ * Slots: CV, except every CV_POT_SLOTS-th, which samples the pot; one pot
+ * slot a second becomes two temperature slots (the first only settles the
+ * indicator). ADCON1 stays as main.c sets it (left-justified, Fosc/64).
+ */
+
+#include "cv.h"
+#include "clock.h"
+#include "synth.h"
+#include "tempco.h"
+#include "clc_debounce.h"
+
+#if CLC_DEBOUNCE_TIMER == 2
+#error "CV mode needs TMR2: set CLC_DEBOUNCE_TIMER to 4 or 6"
+#endif
+
+#define ADCON0_CV       0x05    /* CHS = 000001 ANA1 (RA1), ADON */
+#define ADCON0_POT      0x01    /* CHS = 000000 ANA0 (RA0), ADON */
+#define ADACT_TMR2      0x04
+#define TEMP_POTS       50      /* Pot slots per temperature reading */
+#define TOP             0xFF00U /* Last table entry, Q8.8 */
+
+/* Slot being converted */
+#define SLOT_CV         0
+#define SLOT_POT        1
+#define SLOT_SETTLE     2
+#define SLOT_TEMP       3
+
+static volatile uint8_t active;
+static uint8_t slot;
+static uint8_t pot_slots;
+static uint8_t temp_pots;
+static uint8_t n;
+static uint16_t sum;
+static volatile uint16_t level;         /* Last CV_AVERAGE samples summed */
+static volatile uint16_t base;          /* Q8.8 table position at 0 V */
+static uint16_t last;                   /* Position last loaded */
+static volatile uint8_t pot_val, pot_new;
+static volatile uint16_t temp_val;
+static volatile uint8_t temp_new;
+
+void cv_start(void) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    T2CON = 0x00;
+    PR2 = 249;
+    TMR2 = 0;
+    slot = SLOT_CV;
+    pot_slots = 0;
+    temp_pots = 0;
+    n = 0;
+    sum = 0;
+    last = 0xFFFF;                      /* Load on the first update */
+    ADCON0 = ADCON0_CV;
+    ADACT = ADACT_TMR2;
+    PIR1bits.ADIF = 0;
+    PIE1bits.ADIE = 1;
+    active = 1;
+    T2CON = 0x05;
+    INTCONbits.GIE = gie;
+}
+
+void cv_stop(void) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    T2CON = 0x00;
+    ADACT = 0x00;
+    PIE1bits.ADIE = 0;
+    PIR1bits.ADIF = 0;
+    ADCON0 = ADCON0_POT;                /* Also ends a conversion */
+    active = 0;
+    INTCONbits.GIE = gie;
+}
+
+uint8_t cv_active(void) {
+    return active;
+}
+
+void cv_set_base(uint32_t mhz) {
+    uint16_t p = (uint16_t)(synth_log_position(mhz) >> 16);
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    base = p;
+    last = 0xFFFF;
+    INTCONbits.GIE = gie;
+}
+
+uint16_t cv_mv(void) {
+    uint16_t l;
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    l = level;
+    INTCONbits.GIE = gie;
+    return (uint16_t)(((uint32_t)l * 625) >> 8);   /* 5000 / 2048 */
+}
+
+uint8_t cv_pot(uint8_t *pot) {
+    if (!pot_new) {
+        return 0;
+    }
+    *pot = pot_val;
+    pot_new = 0;
+    return 1;
+}
+
+uint8_t cv_temp(uint16_t *code) {
+    if (!temp_new) {
+        return 0;
+    }
+
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    *code = temp_val;
+    temp_new = 0;
+    INTCONbits.GIE = gie;
+    return 1;
+}
+
+void cv_isr(void) {
+    if (!PIE1bits.ADIE || !PIR1bits.ADIF) {
+        return;                         /* Polled conversions (main.c) */
+    }
+    PIR1bits.ADIF = 0;
+
+    uint8_t h = ADRESH;
+    uint16_t code = ((uint16_t)h << 2) | (ADRESL >> 6);
+    uint8_t done = slot;
+
+    // Next slot's channel first: it acquires until the next trigger
+    slot = SLOT_CV;
+    if (done == SLOT_SETTLE) {
+        slot = SLOT_TEMP;
+    } else if (++pot_slots == CV_POT_SLOTS) {
+        pot_slots = 0;
+        slot = SLOT_POT;
+        if (++temp_pots == TEMP_POTS) {
+            temp_pots = 0;
+            slot = SLOT_SETTLE;
+        }
+    }
+    ADCON0 = (slot == SLOT_CV) ? ADCON0_CV :
+             (slot == SLOT_POT) ? ADCON0_POT : TEMPCO_ADCON0;
+
+    switch (done) {
+        case SLOT_CV:
+            sum += code;
+            if (++n == CV_AVERAGE) {
+                // Move the output to base + CV (inline: the retune is
+                // deep enough from here)
+                uint16_t p = base + (sum << 3); /* Mean × 16: 1 V/octave */
+                if (p < base || p > TOP) {
+                    p = TOP;
+                }
+                if (p != last) {
+                    last = p;
+                    clock_retune(synth_log_entry((uint32_t)p << 16));
+                }
+                level = sum;
+                sum = 0;
+                n = 0;
+            }
+            break;
+        case SLOT_POT:
+            pot_val = h;
+            pot_new = 1;
+            break;
+        case SLOT_TEMP:
+            temp_val = code;
+            temp_new = 1;
+            break;
+        default:
+            break;
+    }
+}
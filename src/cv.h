@@ -0,0 +1,103 @@
+/**
+ * Control Voltage Input for PIC16F18346
+ *
+ * Turns PICclock into a VCO: a control voltage on RA1 (ANA1, 0..VDD)
+ * moves the output exponentially from the frequency the pot sets, one
+ * octave per volt at VDD = 5 V:
+ *
+ *   f = f_pot × 2^(V / 1 V)       0..5 V: five octaves up, to 1 MHz
+ *
+ * The ADC is triggered by TMR2 at CV_SAMPLE_HZ and its interrupt reads
+ * every result, so conversions run continuously without the CPU waiting
+ * on them. Each CV_AVERAGE CV samples are summed and added to the pot's
+ * freq_table position; the table has 12.79 entries per octave and the
+ * 10-bit reading 204.8 codes per volt, so the Q8.8 position moves by
+ * 15.994 per code, taken as 16 (a 0.04% scale error, 0.2 cent over five
+ * octaves; the scale otherwise follows VDD). synth_log_entry interpolates
+ * the entry, as the log sweep and pot ranges do, and clock_retune loads
+ * it with the crystal correction. NCO increment writes never touch the
+ * accumulator, so every update is phase continuous; software clock
+ * entries (below 12 Hz) take effect at the next edge.
+ *
+ * While CV mode runs it owns the ADC and takes the pot (every
+ * CV_POT_SLOTS samples, 50 Hz) and the temperature indicator (once a
+ * second, two slots so the indicator has its 200 µs acquisition time)
+ * between CV samples; main.c's adc task reads them from here.
+ *
+ * Latency and bandwidth (CV_SAMPLE_HZ 6 kHz, CV_AVERAGE 2):
+ *
+ *   Sampling      every 167 µs; conversion 11.5 TAD = 31 µs
+ *   Update        every 333 µs, the mean of the last two samples
+ *   Latency       a CV step reaches the NCO with the next update: in part
+ *                 31 µs plus the update interrupt (the `isr` WCET of T)
+ *                 after a sample at best, completely after 530 µs plus
+ *                 the interrupt at worst (the step lands between the two
+ *                 samples of a pair); group delay about 280 µs plus the
+ *                 interrupt. The output edges follow within one output
+ *                 half period.
+ *   Bandwidth     mean of two (cos(πf/6 kHz)) and the 333 µs hold
+ *                 (sinc(f/3 kHz)): −0.7 dB at 500 Hz, −3 dB at 1.0 kHz.
+ *                 Modulation above the 1.5 kHz update Nyquist aliases;
+ *                 RA1 is also ICSPCLK, so it takes no capacitor: drive
+ *                 it through 10 kΩ only, band-limit the CV in the source
+ *                 if needed, and unplug the source for programming.
+ *
+ * TMR2 is used here, so the step button debounce must be on TMR4 or TMR6
+ * (CLC_DEBOUNCE_TIMER, clc_debounce.h).
+ */
+
+#ifndef CV_H
+#define CV_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define CV_SAMPLE_HZ    6000    /* TMR2: Fosc/4 / 4 / 250 */
+#define CV_AVERAGE      2       /* Samples per update */
+#define CV_POT_SLOTS    120     /* Samples per pot sample (50 Hz) */
+
+#define CV_AUTO         0x01    /* settings_t.cv: start CV mode at power-up */
+
+/**
+ * Take the ADC and follow the CV from the next sample. The frequency at
+ * 0 V is the freq_table start until cv_set_base is called.
+ */
+void cv_start(void);
+
+/**
+ * Give the ADC back (pot channel selected, no conversion running).
+ */
+void cv_stop(void);
+
+/**
+ * Nonzero while CV mode runs.
+ */
+uint8_t cv_active(void);
+
+/**
+ * Frequency at 0 V, in mHz within 1 Hz..1 MHz (the pot's).
+ */
+void cv_set_base(uint32_t mhz);
+
+/**
+ * Last CV reading in mV (VDD = 5 V).
+ */
+uint16_t cv_mv(void);
+
+/**
+ * New pot reading (8 bits) since the last call: returns 0 if none.
+ */
+uint8_t cv_pot(uint8_t *pot);
+
+/**
+ * New 10-bit temperature indicator reading since the last call.
+ */
+uint8_t cv_temp(uint16_t *code);
+
+/**
+ * ADC interrupt handler. Call from the ISR on every interrupt; it checks
+ * its own flag.
+ */
+void cv_isr(void);
+
+#endif /* CV_H */
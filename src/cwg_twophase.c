@@ -0,0 +1,65 @@
+/**
+ * CWG Two-Phase Non-Overlapping Clock for PIC16F18346
+ *
+ * CWG1 register usage (Section 20, DS40001800E):
+ *
+ *   CWG1CLKCON = 0x00   CWG clock = FOSC (24 MHz → 41.67 ns dead-band LSB)
+ *   CWG1DAT    = 0x07   Input = NCO1 output
+ *              = 0x00   Input = CWG1PPS pin (RB6 in software/step mode)
+ *   CWG1DBR/DBF         Rising/falling dead band, 6 bits, double-buffered
+ *   CWG1CON0   = 0x84   Enable, half-bridge mode (MODE = 0b100)
+ *
+ * The input and the CWG clock are both FOSC-synchronous in NCO mode, so
+ * the dead band has no ±1 count uncertainty there. With the RB6 pin as
+ * input the edges are still FOSC-aligned, but pass through the input
+ * synchronizer first.
+ */
+
+#include <xc.h>
+#include "cwg_twophase.h"
+
+#define CWG_DAT_PIN         0x00    /* CWG1PPS input */
+#define CWG_DAT_NCO1        0x07    /* NCO1 output */
+
+#define CWG_MODE_HALF_BRIDGE 0x04
+#define CWG_CON0_EN         0x80
+
+/* Dead-band counts for a time in ns: 24 counts per µs, rounded up */
+#define CWG_NS_TO_COUNTS(ns) ((uint8_t)(((uint32_t)(ns) * 3 + 124) / 125))
+
+void cwg_twophase_init(void) {
+    CWG1CON0 = 0x00;                /* Disable while configuring */
+
+    /* RB6 (Port B base 0x08, pin 6) as pin input for non-NCO modes */
+    CWG1PPS = 0x0E;
+
+    /* Route CWG1A → RB4 (PHI1), CWG1B → RB5 (PHI2), Table 13-3 */
+    RB4PPS = 0x08;
+    RB5PPS = 0x09;
+
+    CWG1CLKCON = 0x00;              /* Dead-band clock = FOSC */
+    CWG1DAT    = CWG_DAT_NCO1;
+    CWG1CON1   = 0x00;              /* Outputs active high */
+    CWG1AS0    = 0x00;              /* No auto-shutdown */
+    CWG1AS1    = 0x00;
+
+    CWG1DBR = CWG_NS_TO_COUNTS(CWG_TWOPHASE_DEADTIME_NS);
+    CWG1DBF = CWG_NS_TO_COUNTS(CWG_TWOPHASE_DEADTIME_NS);
+
+    CWG1CON0 = CWG_CON0_EN | CWG_MODE_HALF_BRIDGE;
+}
+
+void cwg_twophase_set_deadtime(uint16_t ns) {
+    if (ns > CWG_TWOPHASE_DEADTIME_MAX_NS) {
+        ns = CWG_TWOPHASE_DEADTIME_MAX_NS;
+    }
+
+    /* Buffered values transfer on the next input rising edge */
+    CWG1DBR = CWG_NS_TO_COUNTS(ns);
+    CWG1DBF = CWG_NS_TO_COUNTS(ns);
+    CWG1CON0bits.LD = 1;
+}
+
+void cwg_twophase_source(uint8_t from_nco) {
+    CWG1DAT = from_nco ? CWG_DAT_NCO1 : CWG_DAT_PIN;
+}
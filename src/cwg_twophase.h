@@ -0,0 +1,61 @@
+/**
+ * CWG Two-Phase Non-Overlapping Clock for PIC16F18346
+ *
+ * Uses the Complementary Waveform Generator in half-bridge mode to turn
+ * the NCO1 clock into two non-overlapping phases for NMOS CPUs (6800,
+ * 8080-style) that need a PHI1/PHI2 pair:
+ *
+ *   RB4 = CWG1A (PHI1): input, rising edge delayed by the dead band
+ *   RB5 = CWG1B (PHI2): inverted input, rising edge delayed by the dead band
+ *
+ * The dead band is counted in CWG clocks (FOSC = 24 MHz, 41.67 ns per
+ * count), so it is independent of the NCO increment and stays constant
+ * across the whole frequency sweep. It must stay below the shortest half
+ * period (500 ns at 1 MHz) or PHI1/PHI2 would disappear at the top of
+ * the range.
+ *
+ * In NCO mode the CWG is fed from NCO1 directly. In software and step
+ * modes NCO1 is stopped, so the CWG input is switched to the RB6 pin
+ * (via CWG1PPS) and the phases follow the firmware-driven clock.
+ *
+ * RB4/RB5 are logic-level outputs straight from the PIC; they do not pass
+ * through the 74HC00 mux or the EL7232 driver.
+ */
+
+#ifndef CWG_TWOPHASE_H
+#define CWG_TWOPHASE_H
+
+#include <xc.h>
+#include <stdint.h>
+
+/* Default dead time between PHI1 and PHI2 (ns), rounded up to CWG clocks */
+#ifndef CWG_TWOPHASE_DEADTIME_NS
+#define CWG_TWOPHASE_DEADTIME_NS    125
+#endif
+
+/* Longest dead time that still leaves both phases alive at 1 MHz */
+#define CWG_TWOPHASE_DEADTIME_MAX_NS  458   /* 11 counts × 41.67 ns */
+
+#if CWG_TWOPHASE_DEADTIME_NS > CWG_TWOPHASE_DEADTIME_MAX_NS
+#error "CWG_TWOPHASE_DEADTIME_NS must be below the 1 MHz half period"
+#endif
+
+/**
+ * Initialize CWG1 in half-bridge mode, fed from NCO1, outputs on RB4/RB5.
+ * Call after nco_init() so the NCO output is already defined.
+ */
+void cwg_twophase_init(void);
+
+/**
+ * Set the dead time in nanoseconds (clamped to CWG_TWOPHASE_DEADTIME_MAX_NS).
+ * Takes effect on the next rising edge of the CWG input, without a glitch.
+ */
+void cwg_twophase_set_deadtime(uint16_t ns);
+
+/**
+ * Select the CWG input: nonzero = NCO1 (NCO mode), 0 = RB6 pin
+ * (software and step modes).
+ */
+void cwg_twophase_source(uint8_t from_nco);
+
+#endif /* CWG_TWOPHASE_H */
@@ -0,0 +1,60 @@
+/**
+ * Fine Tune
+ */
+
+#include "fine.h"
+
+static int16_t offset;                  /* Kept from earlier turns */
+static int16_t turn;                    /* This press */
+static uint8_t from;                    /* Pot at the press */
+static uint8_t held;
+
+static int16_t clamp(int32_t ppm) {
+    if (ppm > FINE_PPM_MAX) {
+        return FINE_PPM_MAX;
+    }
+    if (ppm < -FINE_PPM_MAX) {
+        return -FINE_PPM_MAX;
+    }
+    return (int16_t)ppm;
+}
+
+void fine_press(uint8_t pot) {
+    from = pot;
+    turn = 0;
+    held = 1;
+}
+
+void fine_turn(uint8_t pot) {
+    if (!held) {
+        return;
+    }
+    uint8_t d = (pot >= from) ? pot - from : from - pot;
+    int16_t ppm = clamp(((uint32_t)d * d + 1) / 2);
+
+    turn = (pot >= from) ? ppm : -ppm;
+}
+
+void fine_release(void) {
+    offset = fine_ppm();
+    turn = 0;
+    held = 0;
+}
+
+uint8_t fine_held(void) {
+    return held;
+}
+
+int16_t fine_ppm(void) {
+    return clamp((int32_t)offset + turn);
+}
+
+int16_t fine_around(int16_t base) {
+    return clamp((int32_t)base + offset + turn);
+}
+
+void fine_set(int16_t ppm) {
+    offset = clamp(ppm);
+    turn = 0;
+    held = 0;
+}
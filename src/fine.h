@@ -0,0 +1,66 @@
+/**
+ * Fine Tune
+ *
+ * Moves the output by up to ±FINE_PPM_MAX around the coarse setting (pot
+ * or host entry), far below one 5.57% table step. In run mode, holding
+ * SW3 (the step button) turns the pot into the fine control: its travel
+ * d from where it was at the press adds
+ *
+ *   ±(d² + 1) / 2 ppm      2 ppm at d = 2, 50 at 10, 5000 at 100
+ *
+ * so small movements give ppm steps and a full turn covers more than a
+ * table step. On release the offset is kept, and main.c holds the coarse
+ * setting until the pot moves on; a new coarse setting (pot, F or P)
+ * drops it.
+ *
+ * clock_retune_fine applies it: NCO increments keep the fraction of an
+ * increment, dithered together with the crystal correction's (clock.h),
+ * so the average is within 1 ppm from about 200 Hz up, where one
+ * increment is a large step; software half periods move in 4-cycle
+ * steps (0.33 ppm at 1 Hz).
+ */
+
+#ifndef FINE_H
+#define FINE_H
+
+#include <stdint.h>
+
+#define FINE_PPM_MAX    30000   /* Beyond half a table step either way */
+
+/**
+ * SW3 pressed in run mode with the pot at `pot`.
+ */
+void fine_press(uint8_t pot);
+
+/**
+ * New pot reading while SW3 is held.
+ */
+void fine_turn(uint8_t pot);
+
+/**
+ * SW3 released: keep the offset reached.
+ */
+void fine_release(void);
+
+/**
+ * Nonzero while SW3 is held for fine tuning.
+ */
+uint8_t fine_held(void);
+
+/**
+ * Offset to apply, ppm (including the current turn).
+ */
+int16_t fine_ppm(void);
+
+/**
+ * Offset to apply on top of `base` ppm (a preset's correction, preset.h),
+ * clamped to ±FINE_PPM_MAX like the offset itself.
+ */
+int16_t fine_around(int16_t base);
+
+/**
+ * Replace the offset (startup record), or drop it (0).
+ */
+void fine_set(int16_t ppm);
+
+#endif /* FINE_H */
@@ -0,0 +1,168 @@
+/**
+ * Reference Discipline for PIC16F18346
+ *
+ * CCP4 register usage:
+ *
+ *   CCP4PPS        = 0x02   CCP4 input = RA2 (Port A base 0x00, pin 2)
+ *   CCPTMRS.C4TSEL = 0b10   CCP4 timebase = TMR3 (clock.c, never written)
+ *   CCP4CON        = 0x85   capture every rising edge
+ *                  = 0x86   every 4th rising edge
+ *                  = 0x87   every 16th rising edge
+ *
+ * A gate is one second of reference: `edges` captures. Its last capture
+ * is extended to the 32-bit timeline by its distance back from
+ * clock_time(), which is exact while the ISR answers within half a TMR3
+ * wrap (5.4 ms). The span between consecutive gate ends goes to the task.
+ */
+
+#include <xc.h>
+#include "fll.h"
+#include "fll_loop.h"
+#include "clock.h"
+#include "cal.h"
+#include "tempco.h"
+
+#define TASK_PER_S      10          /* fll_task runs per second */
+
+static uint8_t state;
+static fll_loop_t loop;
+static int16_t base;                /* Correction without the curve */
+static uint16_t runs;               /* Task runs since the last good gate */
+
+static uint16_t edges;              /* Captures per gate */
+static volatile uint16_t edges_left;
+static volatile uint8_t started;    /* t_last is valid */
+static volatile uint32_t t_last;    /* TMR3 time of the last gate end */
+static volatile uint32_t span;      /* TMR3 counts over the last gate */
+static volatile uint8_t ready;
+
+uint8_t fll_start(uint16_t ref_hz) {
+    uint8_t mode;
+
+    if (ref_hz == 0 || ref_hz > FLL_REF_MAX) {
+        return 0;
+    }
+    if ((ref_hz & 15) == 0) {
+        mode = 0x87;
+        edges = ref_hz >> 4;
+    } else if ((ref_hz & 3) == 0) {
+        mode = 0x86;
+        edges = ref_hz >> 2;
+    } else {
+        mode = 0x85;
+        edges = ref_hz;
+    }
+    fll_loop_reset(&loop);
+    runs = 0;
+
+    di();
+    CCP4CON = 0x00;
+    CCP4PPS = 0x02;
+    CCPTMRSbits.C4TSEL = 0b10;
+    edges_left = edges;
+    started = 0;
+    ready = 0;
+    CCP4CON = mode;
+    PIR4bits.CCP4IF = 0;
+    PIE4bits.CCP4IE = 1;
+    state = FLL_ACQUIRE;
+    ei();
+
+    tempco_apply();                 /* Drop a previous estimate */
+    return 1;
+}
+
+void fll_stop(void) {
+    di();
+    PIE4bits.CCP4IE = 0;
+    CCP4CON = 0x00;
+    state = FLL_OFF;
+    ei();
+    fll_loop_reset(&loop);
+    tempco_apply();
+}
+
+uint8_t fll_state(void) {
+    return state;
+}
+
+uint8_t fll_base(int16_t *centi_ppm) {
+    if (state == FLL_OFF || loop.shift == 0) {
+        return 0;
+    }
+    *centi_ppm = base;
+    return 1;
+}
+
+int16_t fll_ppm(void) {
+    return fll_loop_ppm(&loop);
+}
+
+int16_t fll_residual(void) {
+    return (int16_t)(loop.diff / FLL_UNIT);
+}
+
+uint16_t fll_age(void) {
+    return runs / TASK_PER_S;
+}
+
+void fll_task(void) {
+    uint8_t r;
+    uint32_t s;
+
+    if (state == FLL_OFF) {
+        return;
+    }
+    di();
+    r = ready;
+    s = span;
+    ready = 0;
+    ei();
+
+    if (runs != 0xFFFF) {
+        runs++;
+    }
+    if (r) {
+        uint8_t g = fll_loop_update(&loop, (int32_t)(s - FLL_GATE_COUNTS));
+
+        if (g != FLL_GATE_BAD) {
+            int32_t b = (int32_t)fll_loop_ppm(&loop) - tempco_curve();
+
+            if (b > CAL_PPM_MAX) {
+                b = CAL_PPM_MAX;
+            } else if (b < -CAL_PPM_MAX) {
+                b = -CAL_PPM_MAX;
+            }
+            base = (int16_t)b;
+            runs = 0;
+            state = (g == FLL_GATE_LOCK) ? FLL_LOCKED : FLL_ACQUIRE;
+            tempco_apply();
+        }
+    }
+    if (runs >= FLL_HOLD_S * TASK_PER_S && loop.shift != 0) {
+        state = FLL_HOLDOVER;
+    }
+}
+
+void fll_isr(void) {
+    if (!PIE4bits.CCP4IE || !PIR4bits.CCP4IF) {
+        return;
+    }
+    PIR4bits.CCP4IF = 0;
+    if (--edges_left != 0) {
+        return;
+    }
+    edges_left = edges;
+
+    uint8_t l = CCPR4L;
+    uint16_t cap = ((uint16_t)CCPR4H << 8) | l;
+    uint32_t now = clock_time();
+    uint32_t t = now - (uint16_t)((uint16_t)now - cap);
+
+    if (started) {
+        span = t - t_last;
+        ready = 1;
+    }
+    started = 1;
+    t_last = t;
+}
@@ -0,0 +1,88 @@
+/**
+ * Reference Discipline for PIC16F18346
+ *
+ * Locks the output's long-term frequency to a lab reference on RA2: a
+ * 1 PPS signal, or a 10 MHz standard through an external divider to any
+ * whole frequency up to FLL_REF_MAX. CCP4 captures the reference edges
+ * on the free-running TMR3 timeline (clock_time), so every second of
+ * reference is counted in crystal cycles with no dead time between
+ * seconds. fll_loop.c filters those counts into the crystal's error,
+ * which replaces the stored `A` correction (tempco.c adds the curve as
+ * usual) and so steers every NCO increment and software half period,
+ * with the fraction of an increment dithered by clock.c.
+ *
+ * States:
+ *   FLL_OFF       Not started; the stored correction applies.
+ *   FLL_ACQUIRE   Reference seen, the average is still short.
+ *   FLL_LOCKED    Averaging over FLL_SHIFT_LOCK..FLL_SHIFT_MAX gates.
+ *   FLL_HOLDOVER  No usable gate for FLL_HOLD_S: the last estimate stays
+ *                 in use, moved by the temperature curve, until the
+ *                 reference returns (the loop resumes where it was) or
+ *                 fll_stop.
+ *
+ * ISR cost: one capture interrupt per edge CCP4 sees; references that
+ * divide by 16 or 4 use the capture prescaler, e.g. 10 kHz interrupts
+ * 625 times a second. Only the last edge of a second reads the timeline.
+ */
+
+#ifndef FLL_H
+#define FLL_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define FLL_REF_MAX     10000       /* Hz */
+#define FLL_HOLD_S      3           /* Seconds without a gate → holdover */
+
+#define FLL_OFF         0
+#define FLL_ACQUIRE     1
+#define FLL_LOCKED      2
+#define FLL_HOLDOVER    3
+
+/**
+ * Start disciplining to a reference of `ref_hz` (1..FLL_REF_MAX) on RA2,
+ * from no estimate. Returns 0 if the frequency is out of range.
+ */
+uint8_t fll_start(uint16_t ref_hz);
+
+/**
+ * Stop; the stored correction applies again.
+ */
+void fll_stop(void);
+
+/**
+ * Current FLL_* state.
+ */
+uint8_t fll_state(void);
+
+/**
+ * Correction to use instead of the stored `A` value, 0.01 ppm, without
+ * the temperature curve. Returns 0 while there is no estimate.
+ */
+uint8_t fll_base(int16_t *centi_ppm);
+
+/**
+ * Estimated crystal error (0.01 ppm), and the last gate's deviation
+ * from it (0.01 ppm, the loop's residual).
+ */
+int16_t fll_ppm(void);
+int16_t fll_residual(void);
+
+/**
+ * Seconds since the last good gate (holdover age), saturating.
+ */
+uint16_t fll_age(void);
+
+/**
+ * Process a finished gate and time out the reference. Runs every
+ * 100 ms from the scheduler (main.c).
+ */
+void fll_task(void);
+
+/**
+ * CCP4 capture handler. Call from the ISR on every interrupt; it checks
+ * its own flags.
+ */
+void fll_isr(void);
+
+#endif /* FLL_H */
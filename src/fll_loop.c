@@ -0,0 +1,59 @@
+/**
+ * Frequency-Locked Loop Filter for PIC16F18346
+ *
+ * Units: 0.01 ppm / FLL_UNIT, so ±200 ppm is ±8.2 × 10^7 and a gate's
+ * error of e counts is e × 100 × FLL_UNIT / 6 (one count in 6 × 10^6 is
+ * 100/6 × 0.01 ppm), within 32 bits for |e| ≤ FLL_E_MAX. The fine unit
+ * keeps the truncation of the division by 2^shift far below a count.
+ * One 32-bit division per gate (once a second).
+ */
+
+#include "fll_loop.h"
+
+void fll_loop_reset(fll_loop_t *l) {
+    l->est = 0;
+    l->diff = 0;
+    l->shift = 0;
+    l->good = 0;
+    l->bad = 0;
+}
+
+uint8_t fll_loop_update(fll_loop_t *l, int32_t e) {
+    if (e > FLL_E_MAX || e < -FLL_E_MAX) {
+        return FLL_GATE_BAD;            /* Wrong reference or edges lost */
+    }
+    int32_t m = (e * (100 * FLL_UNIT) + (e < 0 ? -3 : 3)) / 6;
+
+    if (l->shift == 0) {
+        l->est = m;
+        l->diff = 0;
+        l->shift = 1;
+        l->good = 0;
+        return FLL_GATE_ACQ;
+    }
+
+    int32_t diff = m - l->est;
+
+    l->diff = diff;
+    if (l->shift >= FLL_SHIFT_LOCK && (diff > FLL_STEP || diff < -FLL_STEP)) {
+        if (++l->bad < FLL_BAD_MAX) {
+            return FLL_GATE_BAD;
+        }
+        l->shift = 1;                   /* Frequency step: acquire again */
+        l->good = 0;
+    }
+    l->bad = 0;
+    l->est += diff / ((int32_t)1 << l->shift);
+
+    if (l->shift < FLL_SHIFT_MAX && ++l->good >= (uint8_t)(1 << l->shift)) {
+        l->shift++;
+        l->good = 0;
+    }
+    return l->shift >= FLL_SHIFT_LOCK ? FLL_GATE_LOCK : FLL_GATE_ACQ;
+}
+
+int16_t fll_loop_ppm(const fll_loop_t *l) {
+    int32_t e = l->est;
+
+    return (int16_t)((e + (e < 0 ? -FLL_UNIT / 2 : FLL_UNIT / 2)) / FLL_UNIT);
+}
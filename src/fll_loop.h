@@ -0,0 +1,64 @@
+/**
+ * Frequency-Locked Loop Filter for PIC16F18346
+ *
+ * The arithmetic of the reference discipline (fll.c), free of registers
+ * so tools/fll_sim.c can run it on a host against simulated references.
+ *
+ * Input: the crystal's count over one second of reference, as the error
+ * e against the nominal FLL_GATE_COUNTS TMR3 counts (Fosc/4). One count
+ * is 0.167 ppm, but gates follow each other without dead time, so the
+ * rounding of one gate is carried by the next and the average over n
+ * gates is good to 0.167/n ppm.
+ *
+ * Filter: est += (m − est) / 2^shift, with m the gate's error in ppm.
+ * The first gate is taken as is; shift then grows by one after 2^shift
+ * gates up to FLL_SHIFT_MAX, so acquisition is fast and the settled loop
+ * averages over 2^FLL_SHIFT_MAX gates. Once at FLL_SHIFT_LOCK, gates
+ * more than FLL_STEP from the estimate are dropped (a missed or extra
+ * reference edge); FLL_BAD_MAX in a row mean a real step, and the loop
+ * acquires again from shift 1.
+ */
+
+#ifndef FLL_LOOP_H
+#define FLL_LOOP_H
+
+#include <stdint.h>
+
+#define FLL_GATE_COUNTS 6000000L    /* TMR3 counts in one second */
+#define FLL_UNIT        4096L       /* est resolution: 0.01 ppm / 4096 */
+#define FLL_E_MAX       1200        /* ±200 ppm in counts per gate */
+#define FLL_SHIFT_LOCK  4           /* Locked from here (~14 s in) */
+#define FLL_SHIFT_MAX   7           /* Settled average: 128 gates */
+#define FLL_STEP        (200 * FLL_UNIT)    /* 2 ppm outlier limit */
+#define FLL_BAD_MAX     4
+
+#define FLL_GATE_BAD    0           /* fll_loop_update results */
+#define FLL_GATE_ACQ    1
+#define FLL_GATE_LOCK   2
+
+typedef struct {
+    int32_t est;            /* Crystal error, 0.01 ppm / FLL_UNIT */
+    int32_t diff;           /* Last gate's error less est, same unit */
+    uint8_t shift;          /* 0 = no estimate yet */
+    uint8_t good;           /* Gates at this shift */
+    uint8_t bad;            /* Outliers in a row */
+} fll_loop_t;
+
+/**
+ * Forget the estimate (next gate is taken as is).
+ */
+void fll_loop_reset(fll_loop_t *l);
+
+/**
+ * Feed one gate's error in TMR3 counts (positive = crystal fast).
+ * Returns FLL_GATE_BAD if it was dropped, else whether the loop is still
+ * acquiring or locked.
+ */
+uint8_t fll_loop_update(fll_loop_t *l, int32_t e);
+
+/**
+ * Estimate rounded to 0.01 ppm (positive = crystal fast, as cal.h).
+ */
+int16_t fll_loop_ppm(const fll_loop_t *l);
+
+#endif /* FLL_LOOP_H */
@@ -0,0 +1,261 @@
+/**
+ * Frequency Meter for PIC16F18346
+ *
+ * TMR1 register usage while measuring:
+ *
+ *   T1CKIPPS / T1GPPS = 0x0E (RB6) or 0x11 (RC1, Port C base 0x10, pin 1)
+ *
+ *   Reciprocal and probe:
+ *     T1CON  = 0x43     TMR1CS = Fosc, 1:1, 16-bit read/write, on
+ *     T1GCON = 0xF0     gate enabled, active high, toggle, single pulse,
+ *                       gate = T1G pin (the signal)
+ *   Direct:
+ *     T1CON  = 0x87     TMR1CS = T1CKI (the signal), asynchronous so the
+ *                       input is not limited by Fosc, on
+ *     T1GCON = 0xE1     gate enabled, active high, toggle, gate = TMR0
+ *                       overflow (1 kHz, the scheduler tick): open and
+ *                       closed for alternate ticks
+ *
+ * TMR1GIF is set whenever the gate closes. In direct mode TMR1 is only
+ * read then, while it is stopped for a whole tick, so the asynchronous
+ * counter needs no synchronised read; pending overflows are counted
+ * first. Afterwards TMR1 is handed back as cal.c leaves it (T1CON = 0x83,
+ * T1GCON = 0x00, T1CKIPPS = RB6).
+ *
+ * Arithmetic: f = periods × Fosc / sum and the crystal correction need a
+ * 64-bit intermediate, done by synth_muldiv (shift and subtract), once per
+ * result.
+ */
+
+#include <xc.h>
+#include "freqmeter.h"
+#include "cal.h"
+#include "synth.h"
+
+#define FOSC_HZ         24000000UL
+#define RECIP_MIN       (FOSC_HZ / METER_RECIP_HZ)  /* Shortest reciprocal period */
+
+#define PPS_RB6         0x0E
+#define PPS_RC1         0x11
+
+/* Measurement states */
+#define ST_IDLE         0
+#define ST_PROBE        1       /* First period: picks the method */
+#define ST_RECIP        2
+#define ST_ARM          3       /* Direct: waiting for the first closed tick */
+#define ST_DIRECT       4
+
+static volatile uint8_t state;
+static uint8_t pps;
+static uint16_t gate;
+static volatile uint16_t ms;        /* Ticks since this phase began */
+static volatile uint16_t ovf;       /* TMR1 overflows since the last read */
+static volatile uint32_t sum;       /* Reciprocal: Fosc counts; direct: signal */
+static volatile uint16_t n;         /* Periods or open ticks in `sum` */
+static volatile uint8_t direct;
+static volatile uint8_t seen;       /* Finished with a signal */
+
+/* TMR1 extended by the overflows; TMR1 must be stopped (gate closed) */
+static uint32_t stopped_count(void) {
+    uint16_t hi = ovf;
+    uint8_t l = TMR1L;
+
+    if (PIR1bits.TMR1IF) {
+        PIR1bits.TMR1IF = 0;
+        hi++;
+    }
+    ovf = 0;
+    return ((uint32_t)hi << 16) | ((uint16_t)TMR1H << 8) | l;
+}
+
+static void arm(void) {
+    TMR1H = 0;
+    TMR1L = 0;
+    ovf = 0;
+    PIR1bits.TMR1GIF = 0;
+    T1GCONbits.T1GGO_nDONE = 1;     /* Count the next full period */
+}
+
+static void release(void) {
+    PIE1bits.TMR1IE = 0;
+    PIE1bits.TMR1GIE = 0;
+    T1CON = 0x00;
+    T1GCON = 0x00;
+    T1CKIPPS = PPS_RB6;
+    T1CON = 0x83;                   /* Back to counting T1CKI (stream.c) */
+    state = ST_IDLE;
+}
+
+static void start_direct(void) {
+    T1CON = 0x00;
+    T1GCON = 0xE1;
+    TMR1H = 0;
+    TMR1L = 0;
+    ovf = 0;
+    PIR1bits.TMR1IF = 0;
+    PIR1bits.TMR1GIF = 0;
+    direct = 1;
+    ms = 0;
+    state = ST_ARM;
+    T1CON = 0x87;
+}
+
+uint8_t meter_start(uint8_t source, uint16_t gate_ms) {
+    if (gate_ms < METER_GATE_MIN || gate_ms > METER_GATE_MAX) {
+        return 0;
+    }
+    pps = (source == METER_EXT) ? PPS_RC1 : PPS_RB6;
+    gate = gate_ms;
+    sum = 0;
+    n = 0;
+    ms = 0;
+    direct = 0;
+    seen = 0;
+
+    di();
+    T1CON = 0x00;
+    T1GPPS = pps;
+    T1CKIPPS = pps;
+    T1GCON = 0xF0;
+    T1CON = 0x43;
+    PIR1bits.TMR1IF = 0;
+    PIE1bits.TMR1IE = 1;
+    PIE1bits.TMR1GIE = 1;
+    state = ST_PROBE;
+    arm();
+    ei();
+    return 1;
+}
+
+void meter_abort(void) {
+    di();
+    if (state != ST_IDLE) {
+        seen = 0;
+        release();
+    }
+    ei();
+}
+
+uint8_t meter_busy(void) {
+    return state != ST_IDLE;
+}
+
+uint8_t meter_result(meter_result_t *r) {
+    uint32_t rem, hz;
+    uint16_t milli;
+
+    if (!seen || n == 0 || sum == 0) {
+        return 0;
+    }
+    if (direct) {
+        // sum counts over n ms
+        hz = sum / n * 1000UL;
+        rem = sum % n * 1000UL;
+        hz += rem / n;
+        milli = (uint16_t)(rem % n * 1000UL / n);
+    } else {
+        hz = synth_muldiv(n, FOSC_HZ, sum, &rem);
+        milli = (uint16_t)synth_muldiv(rem, 1000, sum, &rem);
+    }
+
+    // Crystal p fast: the gate was short by p, f × (1 + p) is true
+    int16_t centi = cal_get();
+    if (centi != 0) {
+        uint16_t a = (uint16_t)(centi < 0 ? -centi : centi);
+        uint32_t d = synth_muldiv(hz, a, 100000UL, &rem);   /* mHz */
+        uint32_t m = hz * 1000UL + milli;             /* Exact below 4.29 MHz */
+
+        if (hz < 4294967UL) {
+            m = (centi > 0) ? m + d : m - d;
+            hz = m / 1000;
+            milli = (uint16_t)(m % 1000);
+        } else {
+            hz = (centi > 0) ? hz + d / 1000 : hz - d / 1000;
+        }
+    }
+    r->hz = hz;
+    r->milli = milli;
+    r->direct = direct;
+    return 1;
+}
+
+void meter_tick(void) {
+    if (state == ST_IDLE) {
+        return;
+    }
+    ms++;
+    switch (state) {
+        case ST_PROBE:
+            if (ms >= METER_WAIT_MS) {
+                release();              /* No signal */
+            }
+            break;
+        case ST_RECIP:
+            if (ms >= gate + METER_WAIT_MS) {
+                seen = (n != 0);
+                release();              /* Signal stopped */
+            }
+            break;
+        default:
+            if (ms >= 2 * gate + METER_WAIT_MS) {
+                release();              /* Gate never toggled */
+            }
+            break;
+    }
+}
+
+void meter_isr(void) {
+    if (state == ST_IDLE) {
+        return;
+    }
+    // Overflows first: TMR1 stops when the gate closes, so one pending
+    // here belongs to the count that just ended
+    if (PIR1bits.TMR1IF) {
+        PIR1bits.TMR1IF = 0;
+        ovf++;
+    }
+    if (!PIR1bits.TMR1GIF) {
+        return;
+    }
+    PIR1bits.TMR1GIF = 0;
+
+    uint32_t c = stopped_count();
+
+    switch (state) {
+        case ST_PROBE:
+            if (c < RECIP_MIN) {
+                start_direct();
+                break;
+            }
+            state = ST_RECIP;           /* Probe period only picks the method */
+            ms = 0;
+            arm();
+            break;
+        case ST_RECIP:
+            sum += c;
+            n++;
+            if (ms >= gate) {
+                seen = 1;
+                release();
+            } else {
+                arm();
+            }
+            break;
+        case ST_ARM:
+            TMR1H = 0;                  /* Stopped for this tick */
+            TMR1L = 0;
+            state = ST_DIRECT;          /* Count from the next open tick */
+            break;
+        case ST_DIRECT:
+            TMR1H = 0;
+            TMR1L = 0;
+            sum += c;
+            if (++n >= gate) {
+                seen = 1;
+                release();
+            }
+            break;
+        default:
+            break;
+    }
+}
@@ -0,0 +1,83 @@
+/**
+ * Frequency Meter for PIC16F18346
+ *
+ * Measures the output on RB6 (read back from the pin through PPS, so it
+ * sees exactly what the pin drives) or an external signal on RC1, with
+ * TMR1 and gates derived from the crystal:
+ *
+ *   Reciprocal (below METER_RECIP_HZ): the signal gates TMR1 counting
+ *   Fosc in toggle + single pulse mode, so each measurement is one whole
+ *   signal period to ±41.7 ns (0.04 ppm of 1 s); periods are summed over
+ *   the gate time and f = periods × Fosc / sum.
+ *
+ *   Direct (from METER_RECIP_HZ): TMR1 counts the signal while the TMR0
+ *   tick toggles its gate, open for one 1 ms tick and closed for the
+ *   next, and the count is read only while the gate is closed. The gate
+ *   time is the sum of the open ticks, so ±1 count per ms tick at most
+ *   and usually much less, since the errors of successive ticks cancel
+ *   unless the signal is phase locked to the tick.
+ *
+ * Every measurement starts with one reciprocal period as a probe, which
+ * picks the method. Results are corrected for the crystal (cal_get, so
+ * with temperature and reference discipline), giving the true frequency.
+ *
+ * Needs TMR1 like the calibration (cal.h): run, step or halt mode with no
+ * stream running, and not during a calibration. Mode switches are held
+ * off until it ends.
+ */
+
+#ifndef FREQMETER_H
+#define FREQMETER_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define METER_INT           0       /* RB6 output */
+#define METER_EXT           1       /* RC1 input */
+
+#define METER_GATE_MIN      10      /* ms */
+#define METER_GATE_MAX      10000
+#define METER_RECIP_HZ      10000   /* Reciprocal below, direct from here */
+#define METER_WAIT_MS       2500    /* For the first edges (1 Hz: 2 s) */
+
+typedef struct {
+    uint32_t hz;
+    uint16_t milli;                 /* 0..999 mHz */
+    uint8_t direct;                 /* Method used */
+} meter_result_t;
+
+/**
+ * Start measuring `source` (METER_INT/EXT) over `gate_ms` (METER_GATE_MIN
+ * ..METER_GATE_MAX). Takes TMR1 from the stream engine; the caller checks
+ * the mode. Returns 0 if the gate is out of range.
+ */
+uint8_t meter_start(uint8_t source, uint16_t gate_ms);
+
+/**
+ * Stop a measurement and give TMR1 back.
+ */
+void meter_abort(void);
+
+/**
+ * Nonzero while a measurement is running.
+ */
+uint8_t meter_busy(void);
+
+/**
+ * Result of the last finished measurement. Returns 0 if no signal was
+ * seen within METER_WAIT_MS.
+ */
+uint8_t meter_result(meter_result_t *r);
+
+/**
+ * 1 ms tick (TMR0 ISR): gate time and timeouts.
+ */
+void meter_tick(void);
+
+/**
+ * TMR1 overflow and gate interrupt handler. Call from the ISR on every
+ * interrupt; it checks its own flags.
+ */
+void meter_isr(void);
+
+#endif /* FREQMETER_H */
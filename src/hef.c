@@ -0,0 +1,82 @@
+/**
+ * High-Endurance Flash Access for PIC16F18346
+ *
+ * NVM register usage (Section 10, DS40001800E):
+ *
+ *   NVMCON1.NVMREGS = 0   Program flash (not configuration space)
+ *   NVMCON1.FREE    = 1   Row erase on the next WR
+ *   NVMCON1.LWLO    = 1   Load write latches only; 0 on the last word
+ *                         starts the row write
+ *   NVMCON2               Unlock: 0x55, 0xAA, then set WR
+ *
+ * Only the low byte of each word is used; the high 6 bits are written
+ * as ones (erased state). Offsets wrap within 0x3F00-0x3FFF, so offset
+ * 0 is the start of HEF and offset 128 the row block below it.
+ */
+
+#include <xc.h>
+#include "hef.h"
+
+/* Flash word address of byte `offset` (a macro: hef_read stays a leaf) */
+#define WORD_ADDRESS(offset) \
+    ((HEF_BASE & 0xFF00) | (uint8_t)((offset) + (uint8_t)HEF_BASE))
+
+static void nvm_unlock(void) {
+    NVMCON2 = 0x55;
+    NVMCON2 = 0xAA;
+    NVMCON1bits.WR = 1;         /* CPU stalls until done */
+    NOP();
+    NOP();
+}
+
+void hef_read(uint8_t offset, void *buf, uint8_t len) {
+    uint8_t *p = (uint8_t *)buf;
+
+    NVMCON1bits.NVMREGS = 0;
+    while (len--) {
+        uint16_t addr = WORD_ADDRESS(offset++);     /* Used once in the macro */
+
+        NVMADRH = (uint8_t)(addr >> 8);
+        NVMADRL = (uint8_t)addr;
+        NVMCON1bits.RD = 1;
+        NOP();
+        NOP();
+        *p++ = NVMDATL;
+    }
+}
+
+uint8_t hef_write_row(uint8_t row, const void *buf, uint8_t len) {
+    const uint8_t *p = (const uint8_t *)buf;
+    uint16_t addr = WORD_ADDRESS((uint8_t)(row * HEF_ROW_BYTES));
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    NVMCON1bits.NVMREGS = 0;
+    NVMADRH = (uint8_t)(addr >> 8);
+    NVMADRL = (uint8_t)addr;
+
+    /* Erase the row */
+    NVMCON1bits.FREE = 1;
+    NVMCON1bits.WREN = 1;
+    nvm_unlock();
+
+    /* Load the latches, writing the row with the last word */
+    NVMCON1bits.FREE = 0;
+    NVMCON1bits.LWLO = 1;
+    for (uint8_t i = 0; i < HEF_ROW_BYTES; i++) {
+        NVMADRH = (uint8_t)(addr >> 8);
+        NVMADRL = (uint8_t)addr;
+        NVMDATH = 0x3F;
+        NVMDATL = (i < len) ? *p++ : 0xFF;
+        if (i == HEF_ROW_BYTES - 1) {
+            NVMCON1bits.LWLO = 0;
+        }
+        nvm_unlock();
+        addr++;
+    }
+
+    NVMCON1bits.WREN = 0;
+    uint8_t ok = !NVMCON1bits.WRERR;
+    INTCONbits.GIE = gie;
+    return ok;
+}
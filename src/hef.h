@@ -0,0 +1,58 @@
+/**
+ * High-Endurance Flash Access for PIC16F18346
+ *
+ * The last 128 words of program memory (0x3F80-0x3FFF) are High-Endurance
+ * Flash, rated for 100k erase/write cycles on the low byte of each word.
+ * The 128 words below it are ordinary program flash (10k cycles) used the
+ * same way. Together they are 256 bytes of non-volatile storage in eight
+ * 32-byte rows, numbered from the start of HEF so rows 0-3 stay where
+ * they were:
+ *
+ *   Row 0  0x3F80  Settings (settings.c)
+ *   Row 1  0x3FA0  Playlist steps 0-4 (playlist.c)
+ *   Row 2  0x3FC0  Playlist steps 5-9
+ *   Row 3  0x3FE0  Playlist steps 10-13, startup record (startup.c)
+ *   Row 4  0x3F00  Settings, bytes 32 on
+ *   Row 5  0x3F20  Preset detents (preset.c)
+ *   Row 6  0x3F40  Unused
+ *   Row 7  0x3F60  Unused
+ *
+ * The linker keeps code out of this range (-mreserve in the Makefile).
+ * The addresses are the PIC16F18346's (16K words); other parts stop the
+ * build here rather than write over code.
+ *
+ * Writing a row stalls the CPU for about 4.5 ms (erase, then write) with
+ * interrupts off. NCO1, CWG1 and the CLCs keep running, so hardware
+ * clock outputs are unaffected, but software clock edges and scheduler
+ * ticks are delayed; writes only happen on explicit request, except the
+ * startup record, which main.c rewrites once the NCO output has been
+ * steady at a new frequency or mode for 10 s.
+ */
+
+#ifndef HEF_H
+#define HEF_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#if !defined(_16F18346) && !defined(_16LF18346)
+#error "HEF addresses are for the PIC16F18346 (MCU in the Makefile)"
+#endif
+
+#define HEF_BASE        0x3F80      /* Offset 0; offset 128 is at 0x3F00 */
+#define HEF_ROW_BYTES   32
+#define HEF_ROWS        8
+
+/**
+ * Copy len bytes starting at byte offset (0..255) into buf. Main loop
+ * only: no handler touches the NVM registers.
+ */
+void hef_read(uint8_t offset, void *buf, uint8_t len);
+
+/**
+ * Erase a row (0..HEF_ROWS-1) and program it with len bytes from buf,
+ * padded with 0xFF to HEF_ROW_BYTES. Returns nonzero on success.
+ */
+uint8_t hef_write_row(uint8_t row, const void *buf, uint8_t len);
+
+#endif /* HEF_H */
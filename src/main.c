@@ -1,25 +1,50 @@
 /**
  * PICclock - Hybrid NCO/Software Clock Generator
- * Target: PIC16F18344 @ 24 MHz (external crystal)
- * 
+ * Target: PIC16F18346 @ 24 MHz (external crystal); see src/README.md,
+ * Target and memory, for why not the PIC16F18344
+ *
  * Generates variable-frequency clock output using:
  *   - Hardware NCO for 12 Hz to 1 MHz (zero CPU overhead)
- *   - Software timing for 1 Hz to 11 Hz (trivial overhead at slow speeds)
- * 
+ *   - Timer interrupt clock for 1 Hz to 11 Hz (trivial overhead at slow speeds)
+ *
  * Output on RB6 drives EL7232CNZ line driver.
- * 
+ *
  * Frequency range: 1 Hz to 1 MHz with 50% duty cycle
  * Timing accuracy: Inherits from 24 MHz crystal (typically ±50 ppm)
- * 
+ *
  * NCO FDC mode: F_out = (24 MHz × NCO_INC) / 2^21
+ *
+ * The user interface runs as cooperative tasks on a 1 ms tick (sched.c).
+ * No task blocks; output edges come from hardware or interrupts only.
  */
 
 #include <xc.h>
 #include <stdint.h>
 #include "freq_table.h"
 #include "clc_debounce.h"
+#include "clock.h"
+#include "clc_gate.h"
+#include "step_pulse.h"
+#include "cal.h"
+#include "tempco.h"
+#include "fll.h"
+#include "freqmeter.h"
+#include "sched.h"
+#include "uart.h"
+#include "cmd.h"
+#include "stream.h"
+#include "sweep.h"
+#include "settings.h"
+#include "playlist.h"
+#include "startup.h"
+#include "potmap.h"
+#include "synth.h"
+#include "fine.h"
+#include "preset.h"
+#include "cv.h"
+#include "spread.h"
 
-// Configuration bits for PIC16F18344
+// Configuration bits for PIC16F18346
 #pragma config FEXTOSC = HS    // External oscillator: HS (24 MHz crystal)
 #pragma config RSTOSC = EXT1X  // Power-up oscillator: EXTOSC (no 4x PLL)
 #pragma config CLKOUTEN = OFF  // Clock out disabled
@@ -44,16 +69,51 @@
 // Pin 4:  RA3/MCLR = Reset
 // Pin 5:  RC5 = Debug LED output
 // Pin 6:  RC4 = Step button (SW3, active low)
-// Pin 7:  RC6 = Halt select (SW2, active low)
+// Pin 7:  RC6 = Halt select (SW2, active low, also TMR1 gate)
 // Pin 8:  RC3 = Step mode select (SW1, active low)
+// Pin 16: RC0 = CLC4 ÷2 clock output
+// Pin 15: RC1 = SYNC/M1 input from the target (instruction step); also the
+//          calibration reference and the frequency meter's external input
+// Pin 14: RC2 = WAIT input from the target (active low, gates NCO1)
+// Pin 10: RB7 = UART TX
+// Pin 9:  RC7 = UART RX
 // Pin 11: RB6 = NCO1 output (drives EL7232CNZ)
+// Pin 12: RB5 = CWG1B two-phase PHI2 output
+// Pin 13: RB4 = CWG1A two-phase PHI1 output
+// Pin 17: RA2 = Reference input for discipline (1 PPS .. 10 kHz, CCP4)
 // Pin 19: RA0 = ADC input (pot)
 
 #define DEBUG_LED   LATCbits.LATC5   // Debug LED (active high)
 #define HALT_SEL    PORTCbits.RC6    // Halt select (SW2)
-#define STEP_BTN    CLCDATAbits.MLC1OUT  // Step button (SW3) - HW debounced via 3-CLC
+#define STEP_BTN    CLCDATAbits.MLC2OUT  // Step button (SW3) - HW debounced via CLC2/CLC3
 #define STEP_SEL    PORTCbits.RC3    // Step mode select (SW1)
 
+#define ADC_PHASES  5           // task_adc runs per pot sample (4 ms each)
+#define TEMP_EVERY  50          // Pot samples per temperature sample (1 s)
+#define POT_TAKEOVER 4          // Pot LSBs moved before it replaces a held setting
+#define SAVE_AFTER  40          // task_save runs (10 s) unchanged before saving
+
+static uint8_t mode;            // Mode selected by switches and host (CLOCK_*)
+static uint8_t pot;             // Last accepted pot reading
+static uint8_t coarse;          // Pot reading the output follows
+// Debounced step button on the last run. Starts as pressed, so a press
+// held from power-up (the N v self test) only counts once released:
+// it must not take the pot for fine tune during the test
+static uint8_t btn_last = 0;
+static uint8_t adc_phase;       // task_adc run within the pot period
+static uint8_t temp_count;      // Pot samples since the last temperature
+static uint8_t temp_due;        // Temperature conversion in this period
+static uint8_t ui_ticks;        // UI task runs since reset
+static uint8_t ui_blinks;       // LED phases left showing a range number
+static uint8_t pot_hold;        // Setting held: pot ignored until it moves
+static uint8_t pot_from;        // Pot reading when the hold began
+static uint8_t save_age;        // task_save runs with the output unchanged
+static uint32_t save_entry;     // Output last seen by task_save
+static uint8_t save_mode;
+static int16_t save_fine;
+static uint8_t cv_coarse;       // Pot reading the CV base was set from
+static uint8_t cv_based;        // cv_set_base done since CV mode started
+
 static void adc_init(void) {
     ADCON0 = 0x01;         // AN0 selected, ADC enabled
     ADCON1 = 0x60;         // Left-justified, Fosc/64, Vref = VDD/VSS
@@ -67,270 +127,467 @@ static uint8_t adc_read(void) {
 }
 
 /**
- * Initialize the NCO (Numerically Controlled Oscillator)
- * 
- * FDC mode output frequency = (Fosc × NCO_INC) / 2^21
+ * Blocking temperature indicator reading (startup only), 10 bits.
+ * Leaves the pot channel selected.
+ */
+static uint16_t adc_read_temp(void) {
+    ADCON0 = TEMPCO_ADCON0;
+    __delay_us(200);       // Indicator acquisition time
+    ADCON0bits.GO_nDONE = 1;
+    while (ADCON0bits.GO_nDONE);
+    ADCON0 = 0x01;
+    return ((uint16_t)ADRESH << 2) | (ADRESL >> 6);
+}
+
+static uint8_t read_mode(void) {
+    if (!HALT_SEL) {
+        return CLOCK_HALT;     // Halt has priority over step
+    }
+    if (!STEP_SEL) {
+        return CLOCK_STEP;
+    }
+    return CLOCK_RUN;
+}
+
+/* Frequency to run at: streamed, swept or set by the host, else the pot
+ * (or the preset it is captured by) */
+static uint32_t target_entry(void) {
+    uint32_t entry;
+    int16_t ppm;
+
+    if (stream_active() || sweep_active() || cv_active()) {
+        return clock_entry();
+    }
+    if (cmd_override()) {
+        return cmd_entry();
+    }
+    return preset_snap(coarse, &entry, &ppm) ? entry : potmap_entry(coarse);
+}
+
+/* Fine tune on top of it: none for streams and sweeps, a preset's own
+ * correction plus the SW3 offset for presets */
+static int16_t target_fine(void) {
+    uint32_t entry;
+    int16_t ppm = 0;
+
+    if (stream_active() || sweep_active() || cv_active()) {
+        return 0;
+    }
+    if (!cmd_override()) {
+        preset_snap(coarse, &entry, &ppm);
+    }
+    return fine_around(ppm);
+}
+
+/**
+ * Mode switches (SW1, SW2), then the host mode when both are off. On
+ * return to run mode the current target is applied before the output
+ * restarts. HALT_SEL stops the output in hardware (halt watch); this
+ * poll only records the mode and re-arms the watch. Held off while a
+ * calibration or frequency measurement has TMR1.
  */
-static void nco_init(void) {
-    // Configure RB6 as NCO1 output
-    TRISBbits.TRISB6 = 0;       // Output
-    ANSELBbits.ANSB6 = 0;       // Digital
-    
-    // Route NCO1 to RB6 via PPS (Peripheral Pin Select)
-    RB6PPS = 0x1D;              // NCO1 output (0x1D per datasheet Table 13-3)
-    
-    NCO1CON = 0x00;             // Disable NCO while configuring
-    NCO1CLK = 0x01;             // Clock source = FOSC (24 MHz external crystal)
-
-    // Set initial value
-    NCO1INCU = 0x00;            // Upper bits
-    NCO1INCH = 0x00;            // High byte
-    NCO1INCL = 0x01;            // Low byte - minimum frequency initially
-    
-    // Clear accumulator
-    NCO1ACCU = 0x00;
-    NCO1ACCH = 0x00;
-    NCO1ACCL = 0x00;
-    
-    // Enable NCO in Fixed Duty Cycle (FDC) mode - 50% duty cycle output
-    NCO1CON = 0x90;             // N1EN=1, N1PFM=0 (FDC mode), N1POL=1
+static void task_switches(void) {
+    if (cal_busy() || meter_busy()) {
+        return;                 // TMR1 is measuring; apply changes after
+    }
+    uint8_t m = read_mode();
+    if (m == CLOCK_RUN) {
+        m = cmd_mode();
+    }
+    if (m != mode) {
+        mode = m;
+        if (m == CLOCK_BURST || m == CLOCK_COUNT || m == CLOCK_ISTEP) {
+            stream_stop();      // TMR1/CCP1 do the counted stop instead
+        }
+        if (m != CLOCK_STEP && m != CLOCK_HALT) {
+            clock_retune_fine(target_entry(), target_fine());
+        }
+        clock_set_mode(m);      // Halt: the gate has usually parked RB6 already
+    }
+    clock_halt_watch(!stream_active());
 }
 
 /**
- * Update NCO frequency from 20-bit increment value
+ * Halt + step button: the next pot range that is valid (range 0 always
+ * is), stored at once so a standalone unit keeps it, and shown on the
+ * LED as range + 1 flashes.
  */
-static void nco_set_increment(uint32_t inc) {
-    // Temporarily disable NCO to update increment atomically
-    NCO1CON = 0x00;
-    
-    NCO1INCL = (uint8_t)(inc & 0xFF);
-    NCO1INCH = (uint8_t)((inc >> 8) & 0xFF);
-    NCO1INCU = (uint8_t)((inc >> 16) & 0x0F);  // Only 4 bits in upper
-    
-    NCO1CON = 0x90;  // Enable NCO, FDC mode, inverted
+static void next_range(void) {
+    settings_t *s = settings_get();
+    uint8_t r = s->pot_range;
+
+    do {
+        if (++r == POTMAP_RANGES) {
+            r = 0;
+        }
+    } while (!potmap_select(r));
+    preset_map();
+    s->pot_range = r;
+    settings_save();
+    ui_blinks = 2 * (r + 1);
+}
+
+/**
+ * Step button: in step mode the pulse itself (and its auto-repeat) is
+ * generated in hardware from the debounced press (step_pulse.h); this
+ * task only passes on S commands. In burst mode a press (or S) outputs
+ * one burst, in count mode it runs one more cycle and in instruction
+ * step mode it runs to the next SYNC edge; each is ignored while the
+ * last one is still running. In run mode a press starts the playlist
+ * when it is set to trigger, and while held the pot fine tunes
+ * (fine.h); on release the coarse setting is held until the pot moves
+ * on. In halt mode a press selects the next pot range.
+ */
+static void task_step(void) {
+    uint8_t pressed = (btn_last != 0 && STEP_BTN == 0);
+    btn_last = STEP_BTN;
+
+    if (fine_held() && STEP_BTN != 0) {
+        fine_release();
+        pot_hold = 1;
+        pot_from = pot;
+    }
+
+    if (clock_counting()) {
+        if (pressed || cmd_take_step()) {
+            if (mode == CLOCK_BURST) {
+                clock_burst(settings_get()->burst);
+            } else if (mode == CLOCK_COUNT) {
+                clock_run_to(clock_cycle() + 1);
+            } else {
+                clock_step_sync();
+            }
+        }
+        return;
+    }
+
+    if (mode == CLOCK_HALT) {
+        if (pressed && !cal_busy() && !meter_busy()) {
+            next_range();
+        }
+        return;
+    }
+
+    if (mode != CLOCK_STEP) {
+        // In run mode the button can trigger the playlist
+        if (pressed && mode == CLOCK_RUN) {
+            fine_press(pot);
+        }
+        if (pressed && mode == CLOCK_RUN && !cal_busy() && !meter_busy() &&
+            (settings_get()->playlist & PLAYLIST_TRIGGER) && playlist_count() != 0) {
+            sweep_stop();
+            cv_stop();
+            stream_play();
+        }
+        return;
+    }
+
+    if (cmd_take_step()) {
+        step_pulse_fire();      // Button presses trigger it in hardware
+    }
+}
+
+/* New pot reading: coarse setting, fine tune or takeover */
+static void pot_sample(uint8_t adc_val) {
+    // Ignore ±1 LSB jitter
+    if (adc_val > pot + 1 || adc_val < pot - 1) {
+        pot = adc_val;
+    }
+    if (fine_held()) {
+        fine_turn(pot);
+    } else if (!pot_hold) {
+        coarse = pot;
+    } else if (pot > pot_from + POT_TAKEOVER || pot + POT_TAKEOVER < pot_from) {
+        pot_hold = 0;       // New coarse setting: drop the fine tune
+        coarse = pot;
+        fine_set(0);
+        cmd_pot_moved();
+    }
+}
+
+/**
+ * Pot and temperature sampling in ADC_PHASES runs (20 ms): the pot is
+ * read in phase 0 and converted again in the last phase, as before; every
+ * TEMP_EVERY periods the phases between acquire and convert the
+ * temperature indicator. The task never waits on the ADC. In CV mode the
+ * ADC interrupt (cv.c) samples both and the task only takes the results;
+ * the phases restart with a pot conversion when it ends.
+ */
+static void task_adc(void) {
+    uint8_t v;
+    uint16_t code;
+
+    if (cv_active()) {
+        if (cv_pot(&v)) {
+            pot_sample(v);
+        }
+        if (cv_temp(&code)) {
+            tempco_sample(code);
+        }
+        adc_phase = ADC_PHASES - 1;
+        temp_due = 0;
+        return;
+    }
+
+    switch (adc_phase) {
+        case 0:
+            // Pot conversion started in the last phase is done
+            pot_sample(ADRESH);
+            if (++temp_count == TEMP_EVERY) {
+                temp_count = 0;
+                temp_due = 1;
+            }
+            break;
+        case 1:
+            if (temp_due) {
+                ADCON0 = TEMPCO_ADCON0;     // Acquire until the next phase
+            }
+            break;
+        case 2:
+            if (temp_due) {
+                ADCON0bits.GO_nDONE = 1;
+            }
+            break;
+        case 3:
+            if (temp_due) {
+                tempco_sample(((uint16_t)ADRESH << 2) | (ADRESL >> 6));
+                ADCON0 = 0x01;              // Back to AN0 (pot)
+                temp_due = 0;
+            }
+            break;
+        default:
+            ADCON0bits.GO_nDONE = 1;        // Pot sample, read in phase 0
+            break;
+    }
+    if (++adc_phase == ADC_PHASES) {
+        adc_phase = 0;
+    }
 }
 
 /**
- * Stop NCO output (for step mode or halt)
+ * Apply a pot change, or the pot again after the host releases control
+ * (run mode, and burst/count mode for the next burst or run). In CV mode
+ * the pot only moves the CV's 0 V frequency.
  */
-static void nco_stop(void) {
-    NCO1CON = 0x00;
-    LATBbits.LATB6 = 1;         // Ensure output is high
+static void task_retune(void) {
+    if (mode == CLOCK_STEP || mode == CLOCK_HALT) {
+        return;
+    }
+    if (cv_active()) {
+        // The CV interrupt retunes; the pot sets the frequency at 0 V
+        if (!cv_based || coarse != cv_coarse) {
+            cv_coarse = coarse;
+            cv_based = 1;
+            cv_set_base(synth_mhz(potmap_entry(coarse)));
+        }
+        return;
+    }
+    cv_based = 0;
+
+    uint32_t entry = target_entry();
+    int16_t f = target_fine();
+    if (entry != clock_entry() || f != clock_fine()) {
+        clock_retune_fine(entry, f);
+    }
 }
 
 /**
- * Disconnect NCO from pin (for software mode)
- * Sets RB6 as regular GPIO output
+ * Debug LED: startup blink, then on while the PIC drives the output;
+ * a selected pot range is flashed first.
  */
-static void nco_disconnect(void) {
-    NCO1CON = 0x00;
-    RB6PPS = 0x00;              // Disconnect NCO from RB6, use LATB6
-    LATBbits.LATB6 = 1;
+static void task_ui(void) {
+    if (ui_ticks < 2) {
+        DEBUG_LED = (ui_ticks == 0);
+        ui_ticks++;
+        return;
+    }
+    if (ui_blinks != 0) {
+        ui_blinks--;
+        DEBUG_LED = ui_blinks & 1;
+        return;
+    }
+    DEBUG_LED = (mode != CLOCK_HALT);
 }
 
 /**
- * Reconnect NCO to pin
+ * Keep the startup record on the last-used output (policy STARTUP_LAST):
+ * once the entry, fine tune and host mode have been unchanged for 10 s
+ * (and SW3 is not held), and only if they differ from the record, so
+ * the HEF row is written once per change. The row write stops
+ * interrupts for ~4.5 ms, which only hardware-timed output does not
+ * notice: so NCO output only, and not during a stream, sweep, glide
+ * (its ramp runs RB6 from the software clock below 2 kHz), spread
+ * (a stall drops TMR6 steps and moves the mean) or measurement.
  */
-static void nco_connect(void) {
-    RB6PPS = 0x1D;              // Route NCO1 to RB6
-    NCO1CON = 0x90;             // Enable NCO, FDC mode, inverted
+static void task_save(void) {
+    uint32_t entry = clock_entry();
+    uint8_t m = cmd_mode();
+    int16_t f = clock_fine();
+
+    if (entry != save_entry || m != save_mode || f != save_fine) {
+        save_entry = entry;
+        save_mode = m;
+        save_fine = f;
+        save_age = 0;
+        return;
+    }
+    if (save_age < SAVE_AFTER) {
+        save_age++;
+        return;
+    }
+    if (startup_policy() != STARTUP_LAST || IS_SOFTWARE_MODE(entry) ||
+        stream_active() || sweep_active() || clock_gliding() ||
+        spread_active() || cal_busy() || meter_busy() ||
+        fine_held() || startup_same(entry, m, f)) {
+        return;
+    }
+    startup_save(entry, m, f, STARTUP_LAST);
+}
+
+static sched_task_t tasks[] = {
+    SCHED_TASK("switch", task_switches, 10, 1),
+    SCHED_TASK("step",   task_step,      1, 1),
+    SCHED_TASK("adc",    task_adc,       4, 2),
+    SCHED_TASK("retune", task_retune,   20, 12),
+    SCHED_TASK("ui",     task_ui,      100, 5),
+    SCHED_TASK("cmd",    cmd_task,       2, 1),
+    SCHED_TASK("fll",    fll_task,     100, 7),
+    SCHED_TASK("save",   task_save,    250, 11),
+    SCHED_TASK("spread", spread_task,   20, 15),
+    SCHED_TASK("stream", stream_task,  STREAM_TASK_MS, 2),
+};
+
+void __interrupt() isr(void) {
+    uint16_t start = sched_now();
+
+    stream_isr();               // First: NCO record loads wait for nothing
+    if (PIR0bits.TMR0IF) {
+        PIR0bits.TMR0IF = 0;
+        sweep_tick();
+        clock_tick();
+        meter_tick();
+        sched_tick();
+    }
+    clock_isr();
+    spread_isr();
+    step_pulse_isr();
+    clc_gate_isr();
+    cal_isr();
+    fll_isr();
+    meter_isr();
+    cv_isr();
+    uart_isr();
+    sched_isr_time(start);
+}
+
+/* Start RB6 on `entry` in stored mode `m`, unless the switches say otherwise */
+static void start_output(uint32_t entry, int16_t f, uint8_t m) {
+    mode = read_mode();
+    if (mode == CLOCK_RUN) {
+        mode = m;
+    }
+    clock_init(entry, f, mode);
+    startup_mark();
 }
 
 void main(void) {
+    T5CON = 0x01;               // WCET timer, also times startup (startup_mark)
+
     // Configure I/O
-    // PORTA: RA0=analog in, RA4/RA5=crystal
-    TRISA = 0b00110001;         // RA0,RA4,RA5 input (crystal pins), rest output
-    ANSELA = 0b00000001;        // Only RA0 is analog
+    // PORTA: RA0=analog in, RA1=CV in, RA4/RA5=crystal
+    TRISA = 0b00110111;         // RA0, RA1 (CV), RA2 (reference), RA4/RA5 (crystal) input
+    ANSELA = 0b00000011;        // RA0 and RA1 are analog
     LATA = 0x00;
-    
-    // PORTB: RB6=NCO out
+
+    // PORTB: RB6=NCO out, RB4/RB5=CWG two-phase out, RB7=UART TX
     TRISB = 0b00000000;         // All outputs
     ANSELB = 0x00;              // All digital
     LATB = 0x00;
-    
-    // PORTC: RC3,RC4,RC6 = switch inputs, RC5 = LED out
-    TRISC = 0b01011000;         // RC3,RC4,RC6 inputs, rest outputs
+
+    // PORTC: RC3,RC4,RC6 = switch inputs, RC5 = LED out, RC0 = ÷2 out,
+    // RC1 = SYNC in, RC2 = WAIT in, RC7 = UART RX
+    TRISC = 0b11011110;         // RC1-RC4,RC6,RC7 inputs, rest outputs
     ANSELC = 0x00;              // All digital
     LATC = 0x00;
-    
-    // Enable weak pull-up on step button
-    WPUC = 0b00010000;
-    
-    // Startup LED blink
-    DEBUG_LED = 1;
-    __delay_ms(100);
-    DEBUG_LED = 0;
-    __delay_ms(100);
-    DEBUG_LED = 1;
 
-    clc_debounce_init();
-    adc_init();
-    nco_init();
-
-    // Read initial ADC value
-    uint8_t last_adc = adc_read();
-    uint32_t freq_entry = freq_table[last_adc];
-    uint8_t software_mode = IS_SOFTWARE_MODE(freq_entry) ? 1 : 0;
-    uint32_t half_period = 0;  // For software mode (in cycles)
-    
-    if (software_mode) {
-        nco_disconnect();
-        half_period = GET_FREQ_VALUE(freq_entry);
-    } else {
-        nco_set_increment(GET_FREQ_VALUE(freq_entry));
-    }
-    
-    uint8_t running = 1;
-    uint8_t halted = 0;
-
-    // Main loop
-    while (1) {
-        // Check mode switches
-        uint8_t mode = (HALT_SEL ? 0 : 2) | (STEP_SEL ? 0 : 1);  // Active low switches
-        
-        // Halt mode: stop output, LED off
-        if (mode & 2) {
-            if (!halted) {
-                if (software_mode) {
-                    LATBbits.LATB6 = 1;
-                } else {
-                    nco_stop();
-                }
-                DEBUG_LED = 0;
-                halted = 1;
-                running = 0;
-            }
-            __delay_ms(50);
-            continue;
+    // Enable weak pull-ups on step button, SYNC and WAIT (inactive when
+    // unconnected)
+    WPUC = 0b00010110;
+    WPUA = 0b00000100;          // Reference input idles high when unconnected
+
+    // The output first: the stored frequency and mode (startup.h) from
+    // its 8 HEF bytes and the 4 of the glide (soft start), before the
+    // settings; everything else starts after RB6 is running
+    uint32_t entry;
+    uint8_t m;
+    int16_t f = 0;
+    uint16_t rate;
+    uint8_t flags;
+    uint8_t stored = startup_load(&entry, &m, &f);
+
+    if (stored) {
+        if (settings_glide(&rate, &flags)) {
+            clock_glide(rate, flags);
         }
-        
-        // Step mode: output stopped, manual pulses
-        if (mode & 1) {
-            if (running || !halted) {
-                if (!software_mode) {
-                    nco_disconnect();
-                }
-                LATBbits.LATB6 = 1;
-                running = 0;
-                halted = 1;
-            }
-            DEBUG_LED = 1;
+        start_output(entry, f, m);
+    }
 
-            // Drive output directly from button state (active low)
-            if (STEP_BTN == 0) {
-                // Button pressed: drive clock low (inverted output)
-                LATBbits.LATB6 = 0;
+    settings_load();
+    if (!potmap_select(settings_get()->pot_range)) {
+        settings_get()->pot_range = 0;
+    }
+    // The checked glide; the same as above unless the settings are damaged
+    if (!clock_glide(settings_get()->glide_rate, settings_get()->glide_flags)) {
+        settings_get()->glide_rate = 0;
+    }
+    cmd_init();
+    if (stored) {
+        cmd_restore(m, entry);
+        fine_set(f);
+        pot_hold = 1;
+    } else {
+        // No record (or `O pot`): the pot needs the range from the settings
+        adc_init();
+        entry = potmap_entry(adc_read());
+        m = CLOCK_RUN;
+        start_output(entry, f, m);
+    }
+    preset_map();               // Snaps from the first retune on
 
-                // Enforce minimum 10ms pulse width
-                __delay_ms(10);
+    // Then correct it for the temperature now
+    tempco_init();
+    clc_debounce_init();
+    adc_init();
+    pot = adc_read();
+    coarse = pot;
+    pot_from = pot;
+    uart_init();
+    tempco_sample(adc_read_temp());
+    step_pulse_config(settings_get()->step_width, settings_get()->step_repeat);
+    stream_init();
+    ADCON0bits.GO_nDONE = 1;    // First conversion for task_adc
+    save_entry = entry;
+    save_mode = m;
+    save_fine = f;
 
-                // Hold low while button remains pressed
-                while (STEP_BTN == 0) {
-                    uint8_t m = (HALT_SEL ? 0 : 2) | (STEP_SEL ? 0 : 1);
-                    if (!(m & 1)) break;
-                }
+    if (settings_get()->sweep.flags & SWEEP_AUTO) {
+        sweep_start(&settings_get()->sweep);
+    } else if (settings_get()->cv & CV_AUTO) {
+        cv_start();
+    }
+    if (settings_get()->spread_profile & SPREAD_AUTO) {
+        spread_start(settings_get()->spread_depth, settings_get()->spread_rate,
+                     settings_get()->spread_profile & (uint8_t)~SPREAD_AUTO);
+    }
 
-                // Release: drive clock high
-                LATBbits.LATB6 = 1;
-            }
-            continue;
-        }
-        
-        // --- Variable frequency mode ---
-        
-        // Resume from halt/step mode
-        if (halted) {
-            // Re-read ADC and reconfigure
-            last_adc = adc_read();
-            freq_entry = freq_table[last_adc];
-            software_mode = IS_SOFTWARE_MODE(freq_entry) ? 1 : 0;
-            
-            if (software_mode) {
-                half_period = GET_FREQ_VALUE(freq_entry);
-                // RB6 already disconnected from NCO
-            } else {
-                nco_connect();
-                nco_set_increment(GET_FREQ_VALUE(freq_entry));
-            }
-            DEBUG_LED = 1;  // LED on when running
-            running = 1;
-            halted = 0;
-        }
-        
-        // Software mode: generate clock with delays
-        if (software_mode) {
-            // Low phase
-            LATBbits.LATB6 = 0;
-            
-            // Delay for half period (use 10us chunks for long delays)
-            // At 24 MHz, 10us = 240 cycles
-            // half_period is in cycles, convert to 10us units
-            uint32_t delay_10us = half_period / 240;
-            for (uint32_t i = 0; i < delay_10us; i++) {
-                __delay_us(10);
-                
-                // Check for mode change every ~10ms
-                if ((i & 0x3FF) == 0) {
-                    uint8_t m = (HALT_SEL ? 0 : 2) | (STEP_SEL ? 0 : 1);
-                    if (m != 0) {
-                        LATBbits.LATB6 = 1;
-                        break;  // Exit for loop, main while will catch mode change
-                    }
-                }
-            }
-            
-            // High phase
-            LATBbits.LATB6 = 1;
-            
-            for (uint32_t i = 0; i < delay_10us; i++) {
-                __delay_us(10);
-                
-                // Check for mode change every ~10ms
-                if ((i & 0x3FF) == 0) {
-                    uint8_t m = (HALT_SEL ? 0 : 2) | (STEP_SEL ? 0 : 1);
-                    if (m != 0) break;  // Exit for loop, main while will catch mode change
-                    
-                    // Also check ADC during low phase
-                    uint8_t adc_val = adc_read();
-                    if (adc_val != last_adc) {
-                        if (adc_val > last_adc + 1 || adc_val < last_adc - 1) {
-                            last_adc = adc_val;
-                            freq_entry = freq_table[adc_val];
-                            
-                            // Check if switching to NCO mode
-                            if (!IS_SOFTWARE_MODE(freq_entry)) {
-                                software_mode = 0;
-                                nco_connect();
-                                nco_set_increment(GET_FREQ_VALUE(freq_entry));
-                                break;
-                            } else {
-                                half_period = GET_FREQ_VALUE(freq_entry);
-                                delay_10us = half_period / 240;
-                            }
-                        }
-                    }
-                }
-            }
-        } else {
-            // NCO mode: just poll ADC occasionally
-            uint8_t adc_val = adc_read();
-            if (adc_val != last_adc) {
-                if (adc_val > last_adc + 1 || adc_val < last_adc - 1) {
-                    last_adc = adc_val;
-                    freq_entry = freq_table[adc_val];
-                    
-                    // Check if switching to software mode
-                    if (IS_SOFTWARE_MODE(freq_entry)) {
-                        software_mode = 1;
-                        nco_disconnect();
-                        half_period = GET_FREQ_VALUE(freq_entry);
-                    } else {
-                        nco_set_increment(GET_FREQ_VALUE(freq_entry));
-                    }
-                }
-            }
-            
-            __delay_ms(20);  // NCO runs independently, just poll UI
-        }
+    sched_init(tasks, sizeof(tasks) / sizeof(tasks[0]));
+    INTCONbits.PEIE = 1;
+    INTCONbits.GIE = 1;
+
+    // Step button held at power-up: self test of every table entry (N v)
+    if (PORTCbits.RC4 == 0) {
+        cmd_verify();
     }
-}
\ No newline at end of file
+
+    sched_run();
+}
@@ -0,0 +1,102 @@
+/**
+ * Stored Frequency Playlist
+ *
+ * Record layout in HEF (little-endian, as in stream frames):
+ *
+ *   byte 0-3  freq_table entry (0xFFFFFFFF = blank, end of list)
+ *   byte 4-5  cycles
+ *
+ * Row r (1..3), slot s (0..4) is at HEF offset r × 32 + s × 6; bytes
+ * 30-31 of each row are unused, and row 3 bytes 24-31 hold the startup
+ * record (startup.c).
+ */
+
+#include "playlist.h"
+#include "settings.h"
+#include "hef.h"
+
+#define BLANK_ENTRY     0xFFFFFFFFUL
+
+static uint8_t play_count;
+static uint8_t play_index;
+static uint8_t play_loop;
+
+static uint8_t record_offset(uint8_t i) {
+    uint8_t row = PLAYLIST_FIRST_ROW;
+    while (i >= PLAYLIST_PER_ROW) {
+        i -= PLAYLIST_PER_ROW;
+        row++;
+    }
+    return row * HEF_ROW_BYTES + i * STREAM_REC_BYTES;
+}
+
+static void read_record(uint8_t i, stream_rec_t *r) {
+    uint8_t b[STREAM_REC_BYTES];
+
+    hef_read(record_offset(i), b, sizeof(b));
+    r->entry = (uint32_t)b[0] | ((uint32_t)b[1] << 8) |
+               ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+    r->cycles = (uint16_t)b[4] | ((uint16_t)b[5] << 8);
+}
+
+/* Read-modify-write the row holding record i */
+static uint8_t write_record(uint8_t i, uint32_t entry, uint16_t cycles) {
+    uint8_t row[HEF_ROW_BYTES];
+    uint8_t offset = record_offset(i);
+    uint8_t base = offset & ~(HEF_ROW_BYTES - 1);
+    uint8_t *p = &row[offset - base];
+
+    hef_read(base, row, HEF_ROW_BYTES);
+    p[0] = (uint8_t)entry;
+    p[1] = (uint8_t)(entry >> 8);
+    p[2] = (uint8_t)(entry >> 16);
+    p[3] = (uint8_t)(entry >> 24);
+    p[4] = (uint8_t)cycles;
+    p[5] = (uint8_t)(cycles >> 8);
+    return hef_write_row(base / HEF_ROW_BYTES, row, HEF_ROW_BYTES);
+}
+
+uint8_t playlist_count(void) {
+    stream_rec_t r;
+    uint8_t n = 0;
+
+    while (n < PLAYLIST_MAX) {
+        read_record(n, &r);
+        if (r.entry == BLANK_ENTRY) {
+            break;
+        }
+        n++;
+    }
+    return n;
+}
+
+uint8_t playlist_set(uint8_t i, const stream_rec_t *r) {
+    if (i >= PLAYLIST_MAX || !stream_record_valid(r)) {
+        return 0;
+    }
+    return write_record(i, r->entry, r->cycles);
+}
+
+uint8_t playlist_truncate(uint8_t i) {
+    if (i >= PLAYLIST_MAX) {
+        return 0;
+    }
+    return write_record(i, BLANK_ENTRY, 0xFFFF);
+}
+
+void playlist_rewind(void) {
+    play_count = playlist_count();
+    play_index = 0;
+    play_loop = settings_get()->playlist & PLAYLIST_LOOP;
+}
+
+uint8_t playlist_next(stream_rec_t *r) {
+    if (play_index >= play_count) {
+        if (!play_loop || play_count == 0) {
+            return 0;
+        }
+        play_index = 0;
+    }
+    read_record(play_index++, r);
+    return 1;
+}
@@ -0,0 +1,60 @@
+/**
+ * Stored Frequency Playlist
+ *
+ * Up to PLAYLIST_MAX (frequency, cycle count) steps in HEF rows 1-3, five
+ * 6-byte records per 32-byte row. The list ends at the first blank
+ * (erased) record. Steps are played by the stream engine (stream_play),
+ * so each lasts its cycle count of counted output edges and the next one
+ * takes over at the edge where it ends, with the stream's load latency
+ * on the NCO (stream.h).
+ *
+ * At the end the playlist loops back to step 0 (PLAYLIST_LOOP) or holds
+ * the last frequency. With PLAYLIST_TRIGGER set, pressing the step button
+ * in run mode starts it from step 0.
+ *
+ * Steps are written to HEF as they are set (one row write each); the
+ * loop/trigger flags are part of the settings and saved with C.
+ */
+
+#ifndef PLAYLIST_H
+#define PLAYLIST_H
+
+#include <stdint.h>
+#include "stream.h"
+
+#define PLAYLIST_FIRST_ROW  1
+#define PLAYLIST_PER_ROW    5
+#define PLAYLIST_MAX        14      /* 3 rows × 5 records, less the last
+                                       slot (startup record, startup.h) */
+
+#define PLAYLIST_LOOP       0x01    /* Restart at step 0 after the last */
+#define PLAYLIST_TRIGGER    0x02    /* Step button starts it in run mode */
+
+/**
+ * Number of stored steps.
+ */
+uint8_t playlist_count(void);
+
+/**
+ * Store step i (0..PLAYLIST_MAX-1). Returns 0 if i or the record is
+ * invalid or the flash write failed.
+ */
+uint8_t playlist_set(uint8_t i, const stream_rec_t *r);
+
+/**
+ * End the list before step i (erase record i).
+ */
+uint8_t playlist_truncate(uint8_t i);
+
+/**
+ * Prepare to play from step 0 with the current settings flags.
+ */
+void playlist_rewind(void);
+
+/**
+ * Next step for the stream engine; 0 at the end of a non-looping list.
+ * Called from the main loop (stream_task), which queues steps ahead.
+ */
+uint8_t playlist_next(stream_rec_t *r);
+
+#endif /* PLAYLIST_H */
@@ -0,0 +1,111 @@
+/**
+ * Pot Range and Mapping Law
+ *
+ * A range is one segment (two for POTMAP_KNEE, split at KNEE_POT) with a
+ * start point and a step per pot LSB, rounded down so the interpolated
+ * entries stay inside the range; readings 0 and 255 return the exact end
+ * entries.
+ */
+
+#include "potmap.h"
+#include "synth.h"
+#include "freq_table.h"
+#include "settings.h"
+
+#define LIN_FRAC_BITS   12
+#define LOG_MIN_MHZ     1000UL          /* freq_table range */
+#define LOG_MAX_MHZ     1000000000UL
+#define KNEE_POT        128             /* Pot reading at the knee */
+
+static const potmap_range_t presets[POTMAP_CUSTOM] = {
+    { 1000UL,      0, 1000000000UL, POTMAP_LOG },
+    { 20000UL,     0, 20000000UL,   POTMAP_LOG },
+    { 100000000UL, 0, 1000000000UL, POTMAP_LIN },
+};
+
+static uint8_t table = 1;               /* Range 0: freq_table[pot] */
+static uint8_t law;
+static uint32_t lo_entry, hi_entry;
+static uint32_t base[2];                /* Segment starts */
+static uint32_t step[2];                /* Per LSB */
+
+void potmap_get(uint8_t range, potmap_range_t *r) {
+    *r = (range < POTMAP_CUSTOM) ? presets[range] : settings_get()->pot_custom;
+}
+
+uint8_t potmap_select(uint8_t range) {
+    potmap_range_t r;
+    uint32_t a, b, k = 0, ea, eb;
+
+    if (range >= POTMAP_RANGES) {
+        return 0;
+    }
+    if (range == 0) {
+        table = 1;
+        return 1;
+    }
+    potmap_get(range, &r);
+    if (r.lo_mhz >= r.hi_mhz) {
+        return 0;
+    }
+
+    if (r.law == POTMAP_LIN) {
+        ea = synth_nco_inc(r.lo_mhz);
+        eb = synth_nco_inc(r.hi_mhz);
+        if (ea == 0 || r.hi_mhz > SYNTH_MAX_MHZ) {
+            return 0;
+        }
+        a = ea << LIN_FRAC_BITS;
+        b = eb << LIN_FRAC_BITS;
+    } else if (r.law == POTMAP_LOG || r.law == POTMAP_KNEE) {
+        if (r.lo_mhz < LOG_MIN_MHZ || r.hi_mhz > LOG_MAX_MHZ) {
+            return 0;
+        }
+        if (r.law == POTMAP_KNEE) {
+            if (r.knee_mhz <= r.lo_mhz || r.knee_mhz >= r.hi_mhz) {
+                return 0;
+            }
+            k = synth_log_position(r.knee_mhz);
+        }
+        a = synth_log_position(r.lo_mhz);
+        b = synth_log_position(r.hi_mhz);
+        ea = synth_solve(r.lo_mhz);
+        eb = synth_solve(r.hi_mhz);
+    } else {
+        return 0;
+    }
+
+    law = r.law;
+    lo_entry = ea;
+    hi_entry = eb;
+    base[0] = a;
+    if (law == POTMAP_KNEE) {
+        step[0] = (k - a) / KNEE_POT;
+        base[1] = k;
+        step[1] = (b - k) / (255 - KNEE_POT);
+    } else {
+        step[0] = (b - a) / 255;
+    }
+    table = 0;
+    return 1;
+}
+
+uint32_t potmap_entry(uint8_t pot) {
+    if (table) {
+        return freq_table[pot];
+    }
+    if (pot == 0) {
+        return lo_entry;
+    }
+    if (pot == 255) {
+        return hi_entry;
+    }
+    if (law == POTMAP_LIN) {
+        uint32_t p = base[0] + pot * step[0];
+        return (p + (1UL << (LIN_FRAC_BITS - 1))) >> LIN_FRAC_BITS;
+    }
+    if (law == POTMAP_KNEE && pot >= KNEE_POT) {
+        return synth_log_entry(base[1] + (uint8_t)(pot - KNEE_POT) * step[1]);
+    }
+    return synth_log_entry(base[0] + pot * step[0]);
+}
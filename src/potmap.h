@@ -0,0 +1,67 @@
+/**
+ * Pot Range and Mapping Law
+ *
+ * Maps the 8-bit pot reading onto a selectable frequency range, so the
+ * whole travel is spent where it is needed, with one of three laws:
+ *
+ *   POTMAP_LIN   Constant frequency per LSB. The NCO increment moves
+ *                linearly, so both ends must be in the NCO range
+ *                (11.4 Hz to 1 MHz).
+ *   POTMAP_LOG   Constant ratio per LSB, from lo to hi within 1 Hz..1 MHz
+ *                (software clock and NCO, as the log sweep).
+ *   POTMAP_KNEE  Piecewise log: the first half of the travel goes from lo
+ *                to the knee, the second half from the knee to hi, e.g.
+ *                1 Hz..100 kHz..1 MHz gives the top decade half the pot.
+ *
+ * Ranges, selected with G or halt + step button (main.c):
+ *
+ *   0  1 Hz - 1 MHz log       freq_table itself
+ *   1  20 Hz - 20 kHz log     Audio
+ *   2  100 kHz - 1 MHz lin    Top decade, even steps of ~3.5 kHz
+ *   3  Custom                 settings_t.pot_custom (G command)
+ *
+ * potmap_select turns a range into a start point and a per-LSB step in
+ * the law's own domain (Q8.24 table position or Q20.12 increment, as
+ * sweep.c), with the divisions done there once. potmap_entry is then an
+ * 8 × 24 bit multiply and, for the log laws, an interpolation between two
+ * table entries; range 0 stays a plain table lookup. Both ends of every
+ * range are the exact solved entries.
+ */
+
+#ifndef POTMAP_H
+#define POTMAP_H
+
+#include <stdint.h>
+
+#define POTMAP_LIN      0       /* Same values as SWEEP_LIN / SWEEP_LOG */
+#define POTMAP_LOG      1
+#define POTMAP_KNEE     2
+
+#define POTMAP_RANGES   4
+#define POTMAP_CUSTOM   3
+
+typedef struct {
+    uint32_t lo_mhz;
+    uint32_t knee_mhz;          /* POTMAP_KNEE only */
+    uint32_t hi_mhz;
+    uint8_t law;                /* POTMAP_* */
+} potmap_range_t;
+
+/**
+ * Map the pot through `range` (0..POTMAP_RANGES-1) from now on. Returns
+ * 0, and keeps the current mapping, if the range is out of bounds for its
+ * law (custom ranges only: lo < knee < hi, ends within the law's span).
+ */
+uint8_t potmap_select(uint8_t range);
+
+/**
+ * The definition of a range (the custom one from the settings).
+ */
+void potmap_get(uint8_t range, potmap_range_t *r);
+
+/**
+ * freq_table-format entry for a pot reading.
+ */
+uint32_t potmap_entry(uint8_t pot);
+
+#endif /* POTMAP_H */
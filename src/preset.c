@@ -0,0 +1,133 @@
+/**
+ * Preset Detents
+ *
+ * Positions come from a binary search of potmap_entry, whose frequency
+ * rises with the pot reading in every range: 8 steps per preset, each a
+ * mapping and a synth_mhz, done only when the range or a preset changes.
+ */
+
+#include "preset.h"
+#include "potmap.h"
+#include "synth.h"
+#include "hef.h"
+
+#define PRESET_OFFSET   (PRESET_ROW * HEF_ROW_BYTES)
+#define ERASED          0xFFFFFFFFUL
+#define NO_SNAP         0xFF
+
+static const uint32_t defaults[PRESET_MAX] = PRESET_DEFAULTS;
+
+static uint8_t pos[PRESET_MAX];
+static uint8_t mapped;                  /* Bit i: slot i has a position */
+static uint8_t snap = NO_SNAP;          /* Slot of the cached snap */
+static uint32_t snap_entry;
+static int16_t snap_ppm;
+
+uint32_t preset_get(uint8_t i) {
+    uint8_t b[4];
+    uint32_t mhz;
+
+    if (i >= PRESET_MAX) {
+        return 0;
+    }
+    hef_read(PRESET_OFFSET + i * 4, b, sizeof(b));
+    mhz = (uint32_t)b[0] | ((uint32_t)b[1] << 8) |
+          ((uint32_t)b[2] << 16) | ((uint32_t)b[3] << 24);
+    return (mhz == ERASED) ? defaults[i] : mhz;
+}
+
+uint8_t preset_set(uint8_t i, uint32_t mhz) {
+    uint8_t row[HEF_ROW_BYTES];
+    uint8_t *p = &row[i * 4];
+    uint8_t k;
+
+    if (i >= PRESET_MAX ||
+        (mhz != 0 && synth_solve(mhz) == SYNTH_INVALID)) {
+        return 0;
+    }
+    // Write the defaults out too, so the others keep their values
+    for (k = 0; k < PRESET_MAX; k++) {
+        uint32_t v = preset_get(k);
+        row[k * 4] = (uint8_t)v;
+        row[k * 4 + 1] = (uint8_t)(v >> 8);
+        row[k * 4 + 2] = (uint8_t)(v >> 16);
+        row[k * 4 + 3] = (uint8_t)(v >> 24);
+    }
+    p[0] = (uint8_t)mhz;
+    p[1] = (uint8_t)(mhz >> 8);
+    p[2] = (uint8_t)(mhz >> 16);
+    p[3] = (uint8_t)(mhz >> 24);
+    return hef_write_row(PRESET_ROW, row, HEF_ROW_BYTES);
+}
+
+static uint32_t pot_mhz(uint8_t pot) {
+    return synth_mhz(potmap_entry(pot));
+}
+
+void preset_map(void) {
+    uint32_t lo_mhz = pot_mhz(0);
+    uint32_t hi_mhz = pot_mhz(255);
+    uint32_t below = pot_mhz(1) - lo_mhz;       /* One step beyond each end */
+    uint32_t above = hi_mhz - pot_mhz(254);
+
+    mapped = 0;
+    snap = NO_SNAP;
+    for (uint8_t i = 0; i < PRESET_MAX; i++) {
+        uint32_t mhz = preset_get(i);
+        uint8_t lo = 0, hi = 255;
+
+        if (mhz == 0 || mhz + below < lo_mhz || mhz > hi_mhz + above) {
+            continue;
+        }
+        if (mhz <= lo_mhz || mhz >= hi_mhz) {
+            pos[i] = (mhz <= lo_mhz) ? 0 : 255;
+            mapped |= (uint8_t)(1 << i);
+            continue;
+        }
+        while (hi - lo > 1) {           /* pot_mhz(lo) <= mhz < pot_mhz(hi) */
+            uint8_t mid = (uint8_t)((lo + hi) / 2);
+            if (pot_mhz(mid) <= mhz) {
+                lo = mid;
+            } else {
+                hi = mid;
+            }
+        }
+        pos[i] = (mhz - pot_mhz(lo) <= pot_mhz(hi) - mhz) ? lo : hi;
+        mapped |= (uint8_t)(1 << i);
+    }
+}
+
+uint8_t preset_position(uint8_t i, uint8_t *pot) {
+    if (i >= PRESET_MAX || !(mapped & (1 << i))) {
+        return 0;
+    }
+    *pot = pos[i];
+    return 1;
+}
+
+uint8_t preset_snap(uint8_t pot, uint32_t *entry, int16_t *ppm) {
+    uint8_t best = NO_SNAP, best_d = PRESET_CAPTURE + 1;
+
+    for (uint8_t i = 0; i < PRESET_MAX; i++) {
+        if (mapped & (1 << i)) {
+            uint8_t d = (pot >= pos[i]) ? pot - pos[i] : pos[i] - pot;
+            if (d < best_d) {
+                best = i;
+                best_d = d;
+            }
+        }
+    }
+    if (best == NO_SNAP) {
+        return 0;
+    }
+    if (best != snap) {
+        uint32_t mhz = preset_get(best);
+
+        snap_entry = synth_solve(mhz);
+        snap_ppm = synth_exact_ppm(snap_entry, mhz);
+        snap = best;
+    }
+    *entry = snap_entry;
+    *ppm = snap_ppm;
+    return 1;
+}
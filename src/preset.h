@@ -0,0 +1,76 @@
+/**
+ * Preset Detents
+ *
+ * Up to PRESET_MAX exact frequencies the pot snaps to, for the values a
+ * clock is usually wanted at (32.768 kHz, 921.6 kHz, 894.886 kHz ...)
+ * that no table entry or pot position hits. When the pot reading is
+ * within PRESET_CAPTURE LSB of the position nearest a preset in the
+ * current range (potmap.h; presets up to one step beyond either end
+ * count, so 1 MHz is at the top of the table), the output is that
+ * preset instead: the
+ * solver's entry (synth_solve: NCO increment, or the software clock below
+ * 2 kHz) plus the fine tune that brings it closest (synth_exact_ppm),
+ * dithered below one increment as any fine tune.
+ *
+ * Achieved error: within 0.5 ppm for NCO entries (the fine tune is whole
+ * ppm); software entries move in 4-cycle half period steps, up to ±73 ppm
+ * at 440 Hz and 0.33 ppm at 1 Hz. The crystal correction applies on top,
+ * as for every output. tools/presets.c prints the error of each default
+ * preset, and E <i> the achieved frequency of a stored one.
+ *
+ * Stored in row 5 (hef.h), one 4-byte mHz value per slot, little-endian:
+ * 0 is an empty slot, and an erased slot (0xFFFFFFFF) holds the default
+ * preset of that number, so a fresh part starts with PRESET_DEFAULTS.
+ * Presets outside the current pot range have no position and never snap.
+ */
+
+#ifndef PRESET_H
+#define PRESET_H
+
+#include <stdint.h>
+
+#define PRESET_MAX      8
+#define PRESET_ROW      5
+#define PRESET_CAPTURE  1       /* Pot LSBs either side of the position */
+
+#define PRESET_DEFAULTS { \
+    440000UL,       /* A4 */ \
+    1000000UL, \
+    32768000UL,     /* Watch crystal */ \
+    100000000UL, \
+    614400000UL,    /* UART: 38400 × 16 */ \
+    894886250UL,    /* NTSC colour burst / 4 */ \
+    921600000UL,    /* UART: 57600 × 16 */ \
+    1000000000UL, \
+}
+
+/**
+ * Stored frequency of slot i in mHz, 0 if empty.
+ */
+uint32_t preset_get(uint8_t i);
+
+/**
+ * Store slot i (0..PRESET_MAX-1), 0 to empty it; written to flash at
+ * once. Returns 0 if i or the frequency is out of range or the write
+ * failed. Call preset_map after it, as after potmap_select.
+ */
+uint8_t preset_set(uint8_t i, uint32_t mhz);
+
+/**
+ * Find each preset's pot position in the current range. Call after
+ * potmap_select.
+ */
+void preset_map(void);
+
+/**
+ * Pot position of slot i in the current range; returns 0 if it has none.
+ */
+uint8_t preset_position(uint8_t i, uint8_t *pot);
+
+/**
+ * Entry and fine tune (ppm) of the preset the pot reading is captured
+ * by. Returns 0 if none; cheap when the same preset as last time.
+ */
+uint8_t preset_snap(uint8_t pot, uint32_t *entry, int16_t *ppm);
+
+#endif /* PRESET_H */
@@ -0,0 +1,121 @@
+/**
+ * Cooperative Tick Scheduler for PIC16F18346
+ *
+ * TMR0 in 8-bit mode: Fosc/4 = 6 MHz, prescaler 1:8 → 750 kHz,
+ * period 250 counts (TMR0H = 249), postscaler 1:3 → 1000 Hz exactly.
+ *
+ * TMR5 free-runs at Fosc/4 and is only read, never written, so
+ * execution times are differences of two 16-bit samples (valid up to
+ * 10.9 ms, far beyond any task's budget).
+ */
+
+#include <xc.h>
+#include "sched.h"
+
+static sched_task_t *sched_tasks;
+static uint8_t sched_count;
+static volatile uint8_t sched_pending;      /* Ticks not yet processed */
+static uint16_t sched_late;
+static uint16_t sched_isr_worst;            /* Longest ISR, TMR5 counts */
+
+/* TMR5 has no 16-bit read buffer on this part: re-read on a carry */
+uint16_t sched_now(void) {
+    uint8_t h, l;
+    do {
+        h = TMR5H;
+        l = TMR5L;
+    } while (h != TMR5H);
+    return ((uint16_t)h << 8) | l;
+}
+
+void sched_init(sched_task_t *tasks, uint8_t count) {
+    sched_tasks = tasks;
+    sched_count = count;
+    sched_pending = 0;
+    sched_late = 0;
+    sched_isr_worst = 0;
+
+    /*
+     * TMR0: 1 ms tick
+     *   T0CON1 = 0b010_0_0011: clock Fosc/4, synchronous, prescaler 1:8
+     *   T0CON0 = 0b1_0_0_0010: enable, 8-bit, postscaler 1:3
+     */
+    T0CON0 = 0x00;
+    T0CON1 = 0x43;
+    TMR0H  = 249;               /* 8-bit mode period register */
+    TMR0L  = 0;
+    PIR0bits.TMR0IF = 0;
+    PIE0bits.TMR0IE = 1;
+    T0CON0 = 0x82;
+
+    /* TMR5: free-running Fosc/4 counter for execution time */
+    T5CON = 0x00;
+    TMR5H = 0;
+    TMR5L = 0;
+    T5CON = 0x01;               /* Fosc/4, 1:1, on */
+}
+
+void sched_tick(void) {
+    sched_pending++;
+}
+
+void sched_run(void) {
+    while (1) {
+        if (sched_pending == 0) {
+            continue;
+        }
+
+        di();
+        sched_pending--;
+        if (sched_pending != 0) {
+            sched_late++;       /* Previous pass ran past a tick */
+        }
+        ei();
+
+        for (uint8_t i = 0; i < sched_count; i++) {
+            sched_task_t *t = &sched_tasks[i];
+            if (--t->countdown != 0) {
+                continue;
+            }
+            t->countdown = t->period;
+
+            uint16_t start = sched_now();
+            t->run();
+            uint16_t elapsed = sched_now() - start;
+            if (elapsed > t->wcet) {
+                t->wcet = elapsed;
+            }
+        }
+    }
+}
+
+uint8_t sched_task_count(void) {
+    return sched_count;
+}
+
+const sched_task_t *sched_task(uint8_t i) {
+    return &sched_tasks[i];
+}
+
+uint16_t sched_wcet_us(uint8_t i) {
+    return (sched_tasks[i].wcet + SCHED_TICKS_PER_US - 1) / SCHED_TICKS_PER_US;
+}
+
+uint16_t sched_overruns(void) {
+    return sched_late;
+}
+
+void sched_isr_time(uint16_t start) {
+    uint16_t elapsed = sched_now() - start;
+    if (elapsed > sched_isr_worst) {
+        sched_isr_worst = elapsed;
+    }
+}
+
+uint16_t sched_isr_wcet_us(void) {
+    uint16_t worst;
+    di();
+    worst = sched_isr_worst;
+    ei();
+    return (worst + SCHED_TICKS_PER_US - 1) / SCHED_TICKS_PER_US;
+}
@@ -0,0 +1,94 @@
+/**
+ * Cooperative Tick Scheduler for PIC16F18346
+ *
+ * TMR0 raises a 1 ms tick interrupt. The main loop runs every task whose
+ * period has elapsed, in table order, and each task runs to completion.
+ * Tasks must never block: anything that waits is written as a state
+ * machine that returns and picks up again on its next release.
+ *
+ * Output timing never depends on the tasks — the NCO runs in hardware and
+ * the software clock is interrupt-driven — so tasks only decide *what*
+ * the output does, never *when* an edge happens.
+ *
+ * Every task's execution time is measured with TMR5 (Fosc/4 = 6 MHz,
+ * free-running) and the worst case is kept per task, so a new feature
+ * that makes a task slower shows up in the WCET report instead of
+ * silently stretching the loop.
+ */
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define SCHED_TICK_US       1000    /* TMR0 tick period */
+#define SCHED_TICKS_PER_US  6       /* TMR5 counts per µs (Fosc/4) */
+
+typedef struct {
+    const char *name;       /* Short name for reports */
+    void (*run)(void);      /* Task body, runs to completion */
+    uint8_t period;         /* Release period in ticks (ms) */
+    uint8_t countdown;      /* Ticks until next release */
+    uint16_t wcet;          /* Worst-case execution time, TMR5 counts */
+} sched_task_t;
+
+/* Task table entry; offset (1..period) staggers tasks with equal periods */
+#define SCHED_TASK(name, fn, period, offset) { name, fn, period, offset, 0 }
+
+/**
+ * Start TMR0 (1 ms tick) and TMR5 (execution time counter) and take
+ * ownership of the task table. Interrupts must be enabled by the caller.
+ */
+void sched_init(sched_task_t *tasks, uint8_t count);
+
+/**
+ * Tick interrupt handler. Call from the ISR when TMR0IF is set.
+ */
+void sched_tick(void);
+
+/**
+ * Run released tasks forever. Does not return.
+ */
+void sched_run(void);
+
+/**
+ * Number of tasks in the table.
+ */
+uint8_t sched_task_count(void);
+
+/**
+ * Task by index, for reporting name/period/WCET.
+ */
+const sched_task_t *sched_task(uint8_t i);
+
+/**
+ * Worst-case execution time of task i in microseconds.
+ */
+uint16_t sched_wcet_us(uint8_t i);
+
+/**
+ * Number of ticks on which the loop was still busy when the next tick
+ * arrived (released tasks ran late).
+ */
+uint16_t sched_overruns(void);
+
+/**
+ * Current TMR5 time (Fosc/4 counts). Usable from the ISR.
+ */
+uint16_t sched_now(void);
+
+/**
+ * Record the duration of one interrupt that started at sched_now() ==
+ * start. Call at the end of the ISR.
+ */
+void sched_isr_time(uint16_t start);
+
+/**
+ * Longest interrupt service time in microseconds. Any interrupt-driven
+ * event (a record boundary, a software clock edge) can be delayed by up
+ * to this much by another handler.
+ */
+uint16_t sched_isr_wcet_us(void);
+
+#endif /* SCHED_H */
@@ -0,0 +1,104 @@
+/**
+ * Stored Configuration
+ */
+
+#include <stddef.h>
+#include "settings.h"
+#include "hef.h"
+#include "spread_profile.h"
+
+#define SETTINGS_ROW    0
+#define SETTINGS_ROW2   4           /* Bytes 32 on */
+
+/* The settings must fit two rows */
+typedef char settings_fit_t[(sizeof(settings_t) <= 2 * HEF_ROW_BYTES) ? 1 : -1];
+
+static settings_t current;
+
+static const settings_t defaults = {
+    SETTINGS_VERSION,
+    {
+        100000UL,           /* 100 Hz */
+        10000000UL,         /* 10 kHz */
+        1000,               /* 1 s */
+        SWEEP_LOG,
+        SWEEP_REPEAT,
+        0,
+    },
+    0,                      /* Playlist: play once, no trigger */
+    8,                      /* Burst: 8 cycles */
+    10000,                  /* Step pulse: 10 ms */
+    0,                      /* No auto-repeat */
+    0,                      /* Crystal assumed exact */
+    0, 0, 0, 0,             /* No temperature curve */
+    0,                      /* Pot: whole table */
+    {
+        1000UL,             /* Custom range: 1 Hz */
+        1000000UL,          /* knee 1 kHz */
+        1000000000UL,       /* to 1 MHz */
+        POTMAP_LOG,
+    },
+    0,                      /* CV mode off at power-up */
+    50,                     /* Spread spectrum: ±0.5 % */
+    250,                    /* at 250 Hz */
+    SPREAD_TRI,             /* triangle, off at power-up */
+    0,                      /* No glide */
+    0,                      /* octaves/s, no soft start */
+    0,
+};
+
+static uint8_t byte_sum(const settings_t *s) {
+    const uint8_t *p = (const uint8_t *)s;
+    uint8_t sum = 0;
+
+    for (uint8_t i = 0; i < sizeof(settings_t); i++) {
+        sum += p[i];
+    }
+    return sum;
+}
+
+void settings_load(void) {
+    uint8_t *p = (uint8_t *)&current;
+
+    hef_read(SETTINGS_ROW * HEF_ROW_BYTES, p, HEF_ROW_BYTES);
+    hef_read(SETTINGS_ROW2 * HEF_ROW_BYTES, p + HEF_ROW_BYTES,
+             sizeof(current) - HEF_ROW_BYTES);
+    if (current.version != SETTINGS_VERSION || byte_sum(&current) != 0xFF) {
+        current = defaults;
+    }
+}
+
+uint8_t settings_save(void) {
+    current.version = SETTINGS_VERSION;
+    current.sum = 0;
+    current.sum = 0xFF - byte_sum(&current);
+
+    const uint8_t *p = (const uint8_t *)&current;
+    return hef_write_row(SETTINGS_ROW, p, HEF_ROW_BYTES) &&
+           hef_write_row(SETTINGS_ROW2, p + HEF_ROW_BYTES,
+                         sizeof(current) - HEF_ROW_BYTES);
+}
+
+/* HEF offset of settings byte `at`: row 0, then row 4 */
+static uint8_t stored_at(uint8_t at) {
+    if (at < HEF_ROW_BYTES) {
+        return SETTINGS_ROW * HEF_ROW_BYTES + at;
+    }
+    return SETTINGS_ROW2 * HEF_ROW_BYTES + at - HEF_ROW_BYTES;
+}
+
+uint8_t settings_glide(uint16_t *rate, uint8_t *flags) {
+    uint8_t version;
+
+    hef_read(stored_at(0), &version, 1);
+    if (version != SETTINGS_VERSION) {
+        return 0;
+    }
+    hef_read(stored_at(offsetof(settings_t, glide_rate)), rate, 2);
+    hef_read(stored_at(offsetof(settings_t, glide_flags)), flags, 1);
+    return 1;
+}
+
+settings_t *settings_get(void) {
+    return &current;
+}
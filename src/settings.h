@@ -0,0 +1,68 @@
+/**
+ * Stored Configuration
+ *
+ * One settings_t lives in storage rows 0 and 4 (hef.h): the first 32
+ * bytes in HEF row 0, the rest in row 4. It is read once at power-up; the
+ * command interface edits the RAM copy and writes it back only on the C
+ * command, so flash wear is under host control.
+ *
+ * A stored copy with the wrong version or checksum (blank part, or a
+ * layout change) is ignored and the defaults are used.
+ */
+
+#ifndef SETTINGS_H
+#define SETTINGS_H
+
+#include <stdint.h>
+#include "sweep.h"
+#include "potmap.h"
+
+#define SETTINGS_VERSION    10
+
+typedef struct {
+    uint8_t version;
+    sweep_config_t sweep;   /* W command, SWEEP_AUTO starts it at power-up */
+    uint8_t playlist;       /* PLAYLIST_LOOP / PLAYLIST_TRIGGER */
+    uint16_t burst;         /* Cycles per burst (B command), 1..65535 */
+    uint16_t step_width;    /* Step pulse width in µs (R command) */
+    uint16_t step_repeat;   /* Step auto-repeat period in ms, 0 = off */
+    int16_t cal;            /* Crystal error in 0.01 ppm (A command) */
+    uint16_t tc_ref;        /* Temperature code where `cal` holds (Y) */
+    int16_t tc_c1;          /* Curve: 0.01 ppm per code */
+    int16_t tc_c2;          /*        0.0001 ppm per code² */
+    int16_t tc_c3;          /*        0.000001 ppm per code³ */
+    uint8_t pot_range;      /* Pot range 0..POTMAP_RANGES-1 (G) */
+    potmap_range_t pot_custom;  /* Range POTMAP_CUSTOM */
+    uint8_t cv;             /* CV_AUTO: CV mode at power-up (V) */
+    uint16_t spread_depth;  /* Spread spectrum: ±0.01 % (X) */
+    uint16_t spread_rate;   /* Modulation rate, Hz */
+    uint8_t spread_profile; /* SPREAD_TRI/KISS, SPREAD_AUTO at power-up */
+    uint16_t glide_rate;    /* Glide (J): 0 = off, units per glide_flags */
+    uint8_t glide_flags;    /* CLOCK_GLIDE_CYCLE / CLOCK_GLIDE_START */
+    uint8_t sum;            /* Makes the byte sum of the struct 0xFF */
+} settings_t;
+
+/**
+ * Load the settings from HEF, or the defaults if none are stored.
+ */
+void settings_load(void);
+
+/**
+ * Read just the stored glide (J) for the output started before
+ * settings_load: 3 bytes plus the version, no checksum. Returns 0 if no
+ * settings of this version are stored. settings_load sets it again from
+ * the checked copy.
+ */
+uint8_t settings_glide(uint16_t *rate, uint8_t *flags);
+
+/**
+ * Write the current settings to HEF. Returns nonzero on success.
+ */
+uint8_t settings_save(void);
+
+/**
+ * The current (RAM) settings.
+ */
+settings_t *settings_get(void);
+
+#endif /* SETTINGS_H */
@@ -0,0 +1,110 @@
+/**
+ * Spread-Spectrum Clock for PIC16F18346
+ *
+ * TMR6 register usage while spreading:
+ *
+ *   T6CON  = 0x05     TMR6 on, prescaler 1:4, postscaler 1:1 (rates from
+ *                     183 Hz),
+ *          = 0x06     prescaler 1:16 (from 46 Hz), or
+ *          = 0x07     prescaler 1:64 (below)
+ *   PR6               steps of (PR6 + 1) × prescale Fosc/4 counts
+ *   PIE2.TMR6IE       one interrupt per step
+ *
+ * The levels are recomputed outside the interrupt (eight 16 × 16 bit
+ * products) and copied in with interrupts off, so the handler is a table
+ * read and an increment write.
+ */
+
+#include "spread.h"
+#include "clock.h"
+#include "clc_debounce.h"
+
+#if CLC_DEBOUNCE_TIMER == 6
+#error "Spread spectrum needs TMR6: set CLC_DEBOUNCE_TIMER to 4"
+#endif
+
+static volatile uint8_t active;
+static volatile uint16_t mag[SPREAD_HALF];
+static uint8_t step;                    /* Next step of the period */
+static uint32_t sized_for;              /* Increment mag[] is for */
+static uint16_t depth;
+static uint8_t profile;
+static uint8_t prescale, period;
+
+/* Levels for the increment now loaded, installed between two steps */
+static void size_levels(void) {
+    uint16_t m[SPREAD_HALF];
+    uint32_t inc = clock_nco_inc();
+
+    spread_levels(inc, depth, profile, m);
+    uint8_t gie = INTCONbits.GIE;
+    di();
+    for (uint8_t i = 0; i < SPREAD_HALF; i++) {
+        mag[i] = m[i];
+    }
+    INTCONbits.GIE = gie;
+    sized_for = inc;
+}
+
+uint8_t spread_start(uint16_t d, uint16_t rate, uint8_t p) {
+    if (d == 0 || d > SPREAD_DEPTH_MAX || rate < SPREAD_RATE_MIN ||
+        rate > SPREAD_RATE_MAX || p >= SPREAD_PROFILES) {
+        return 0;
+    }
+    depth = d;
+    profile = p;
+    prescale = spread_timer(rate, &period);
+    size_levels();
+
+    uint8_t gie = INTCONbits.GIE;
+    di();
+    T6CON = 0x00;
+    PR6 = period;
+    TMR6 = 0;
+    step = 0;
+    PIR2bits.TMR6IF = 0;
+    PIE2bits.TMR6IE = 1;
+    T6CON = (prescale == 4) ? 0x05 : (prescale == 16) ? 0x06 : 0x07;
+    active = 1;
+    INTCONbits.GIE = gie;
+    return 1;
+}
+
+void spread_stop(void) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    T6CON = 0x00;
+    PIE2bits.TMR6IE = 0;
+    PIR2bits.TMR6IF = 0;
+    if (active) {
+        active = 0;
+        clock_spread(0);
+    }
+    INTCONbits.GIE = gie;
+}
+
+uint8_t spread_active(void) {
+    return active;
+}
+
+uint32_t spread_rate(void) {
+    return spread_rate_mhz(prescale, period);
+}
+
+void spread_task(void) {
+    if (active && clock_nco_inc() != sized_for) {
+        size_levels();
+    }
+}
+
+void spread_isr(void) {
+    if (!(PIE2bits.TMR6IE && PIR2bits.TMR6IF)) {
+        return;
+    }
+    PIR2bits.TMR6IF = 0;
+    clock_spread(spread_offset(mag, step));
+    if (++step == SPREAD_STEPS) {
+        step = 0;
+    }
+}
@@ -0,0 +1,75 @@
+/**
+ * Spread-Spectrum Clock for PIC16F18346
+ *
+ * Spreads the output's energy over a band around the set frequency, to
+ * lower the peaks its fundamental and harmonics show in an EMI scan: a
+ * TMR6 interrupt steps the NCO1 increment through a triangle or "Hershey
+ * kiss" profile (spread_profile.h) at ±depth, SPREAD_STEPS steps per
+ * modulation period. The NCO is never stopped; each step is one
+ * double-buffered increment write, so the output stays phase continuous.
+ *
+ * Mean frequency: the offsets of one period add up to exactly zero, and
+ * every step lasts the same number of Fosc cycles (the timer period;
+ * interrupt latency moves single loads, but the timer runs on, so the
+ * shifts do not add up), so over whole modulation periods the
+ * accumulator advances exactly as unmodulated and the mean is the target
+ * to the NCO's own resolution. The crystal and fine tune dithering
+ * (clock_tick) add to the offset independently.
+ *
+ * Depth follows the increment: spread_task sizes the levels for the
+ * loaded increment every 20 ms, so pot moves, sweeps, streams and CV
+ * keep their depth; a period that straddles a change moves the phase
+ * by at most one step's offset, once, with no drift. Below about 23 kHz
+ * (increment 2000) ±0.5 % is under 10 increments and the spreading
+ * coarsens; the software clock (below 12 Hz) is not spread.
+ *
+ * Cost: one interrupt per step, SPREAD_STEPS × rate, 16 kHz at the
+ * 500 Hz maximum; the step must stay longer than the `isr` WCET of T.
+ *
+ * TMR6 is used here, so the step button debounce must stay on TMR4
+ * (CLC_DEBOUNCE_TIMER, clc_debounce.h).
+ */
+
+#ifndef SPREAD_H
+#define SPREAD_H
+
+#include <xc.h>
+#include <stdint.h>
+#include "spread_profile.h"
+
+#define SPREAD_AUTO     0x80    /* settings_t.spread_profile: start at power-up */
+
+/**
+ * Start (or change) spreading: `depth` 1..SPREAD_DEPTH_MAX (0.01 %),
+ * `rate` SPREAD_RATE_MIN..MAX Hz, `profile` SPREAD_TRI or SPREAD_KISS.
+ * Returns 0, leaving the current state, if one is out of range.
+ */
+uint8_t spread_start(uint16_t depth, uint16_t rate, uint8_t profile);
+
+/**
+ * Stop spreading and load the plain increment.
+ */
+void spread_stop(void);
+
+/**
+ * Nonzero while spreading.
+ */
+uint8_t spread_active(void);
+
+/**
+ * Modulation rate produced, in mHz (the timer's nearest to the request).
+ */
+uint32_t spread_rate(void);
+
+/**
+ * 20 ms task: size the levels for the increment now loaded.
+ */
+void spread_task(void);
+
+/**
+ * TMR6 interrupt handler: load the next step. Call from the ISR on every
+ * interrupt; it checks its own flags.
+ */
+void spread_isr(void);
+
+#endif /* SPREAD_H */
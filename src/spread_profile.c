@@ -0,0 +1,61 @@
+/**
+ * Spread-Spectrum Profile for PIC16F18346
+ *
+ * Shapes are Q15 levels at t = (2i + 1) / 15, i = 0..7; the top level is
+ * exactly 1. The peak deviation is inc × depth / 10000 rounded, at most
+ * 31457 increments, so a level is one 16 × 16 bit product.
+ */
+
+#include "spread_profile.h"
+#include "synth.h"
+
+#define ONE_Q15     32768UL
+
+static const uint16_t shapes[SPREAD_PROFILES][SPREAD_HALF] = {
+    { 2185, 6554, 10923, 15292, 19661, 24030, 28399, 32768 },   /* t */
+    { 1750, 5295, 8981, 12899, 17144, 21808, 26985, 32768 },    /* 0.8 t + 0.2 t^3 */
+};
+
+void spread_levels(uint32_t inc, uint16_t depth, uint8_t profile,
+                   uint16_t mag[SPREAD_HALF]) {
+    uint32_t peak = (inc * depth + 5000) / 10000;
+
+    // inc - peak >= 1 and inc + peak + 1 (dithered) <= SYNTH_MAX_INC
+    if (peak >= inc) {
+        peak = (inc != 0) ? inc - 1 : 0;
+    }
+    if (inc + peak >= SYNTH_MAX_INC) {
+        peak = (inc < SYNTH_MAX_INC) ? SYNTH_MAX_INC - 1 - inc : 0;
+    }
+    for (uint8_t i = 0; i < SPREAD_HALF; i++) {
+        mag[i] = (uint16_t)((peak * shapes[profile][i] + ONE_Q15 / 2) / ONE_Q15);
+    }
+}
+
+int16_t spread_offset(const volatile uint16_t *mag, uint8_t k) {
+    uint8_t j = (k < SPREAD_STEPS / 2) ? k : (uint8_t)(SPREAD_STEPS - 1 - k);
+
+    if (j >= SPREAD_HALF) {
+        return (int16_t)mag[j - SPREAD_HALF];
+    }
+    return -(int16_t)mag[SPREAD_HALF - 1 - j];
+}
+
+uint8_t spread_timer(uint16_t rate, uint8_t *pr) {
+    uint8_t prescale = 4;
+    uint32_t per = SPREAD_STEPS * (uint32_t)rate;
+    uint32_t counts;
+
+    // Smallest prescaler whose period register reaches: finest steps
+    while ((counts = (SPREAD_FOSC4 / prescale + per / 2) / per) > 256) {
+        prescale *= 4;
+    }
+    *pr = (uint8_t)(counts - 1);
+    return prescale;
+}
+
+uint32_t spread_rate_mhz(uint8_t prescale, uint8_t pr) {
+    uint32_t per = (uint32_t)SPREAD_STEPS * prescale * (pr + 1U);
+
+    return (SPREAD_FOSC4 * 1000UL / 16 + per / 32) / (per / 16);
+}
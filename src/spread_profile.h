@@ -0,0 +1,78 @@
+/**
+ * Spread-Spectrum Profile for PIC16F18346
+ *
+ * The arithmetic of the spread-spectrum modulation (spread.c), free of
+ * registers so tools/spread_spectrum.c can run it on a host and compute
+ * the spectrum it produces.
+ *
+ * One modulation period is SPREAD_STEPS timer steps of equal length. The
+ * increment walks up through 16 levels and back down through the same
+ * levels, so each level is held twice per period, and the levels are
+ * ±pairs (mag[i] and −mag[i]). The offsets of a period therefore add up
+ * to exactly zero in integer increments: the accumulator advances by
+ * SPREAD_STEPS × step × inc per period as it would unmodulated, and the
+ * mean frequency is the target with no rounding at all.
+ *
+ * Profiles, as the level at step time t of a quarter period (t in 0..1,
+ * centre to peak):
+ *
+ *   SPREAD_TRI    t                  Triangle: equal time at every level,
+ *                                    so the spread is flat
+ *   SPREAD_KISS   0.8 t + 0.2 t^3    "Hershey kiss": faster through the
+ *                                    extremes, less energy at the band
+ *                                    edges where the turnarounds dwell
+ *
+ * With only 16 levels the stepped triangle is already close to flat:
+ * at 1 MHz, ±0.5 %, 250 Hz, tools/spread_spectrum.c puts the kiss up to
+ * 1.2 dB ahead at receiver bandwidths of 1 kHz and below, and up to
+ * 0.8 dB behind at 9 kHz.
+ *
+ * Depth is the top level in 0.01 % of the increment. It is limited to
+ * SPREAD_DEPTH_MAX so every offset fits an int16_t (3 % of a 20-bit
+ * increment), and to what keeps inc ± peak a valid increment.
+ */
+
+#ifndef SPREAD_PROFILE_H
+#define SPREAD_PROFILE_H
+
+#include <stdint.h>
+
+#define SPREAD_STEPS        32      /* Timer steps per modulation period */
+#define SPREAD_HALF         8       /* Magnitudes: 16 levels in ± pairs */
+
+#define SPREAD_TRI          0
+#define SPREAD_KISS         1
+#define SPREAD_PROFILES     2
+
+#define SPREAD_DEPTH_MAX    300     /* ±3.00 %, 0.01 % units */
+#define SPREAD_RATE_MIN     20      /* Hz */
+#define SPREAD_RATE_MAX     500     /* 16 kHz steps */
+
+#define SPREAD_FOSC4        6000000UL   /* Timer clock: Fosc/4 */
+
+/**
+ * Level magnitudes for increment `inc`, `depth` (0.01 %) and `profile`,
+ * smallest first.
+ */
+void spread_levels(uint32_t inc, uint16_t depth, uint8_t profile,
+                   uint16_t mag[SPREAD_HALF]);
+
+/**
+ * Offset for step k (0..SPREAD_STEPS-1) of the period: from the lowest
+ * level up to the highest, then back down.
+ */
+int16_t spread_offset(const volatile uint16_t *mag, uint8_t k);
+
+/**
+ * Timer setting for a modulation rate (SPREAD_RATE_MIN..MAX Hz): period
+ * register value in *pr, returns the prescaler in Fosc/4 counts (4, 16
+ * or 64). The rate produced is spread_rate_mhz(prescale, pr).
+ */
+uint8_t spread_timer(uint16_t rate, uint8_t *pr);
+
+/**
+ * Modulation rate in mHz for a timer setting.
+ */
+uint32_t spread_rate_mhz(uint8_t prescale, uint8_t pr);
+
+#endif /* SPREAD_PROFILE_H */
@@ -0,0 +1,111 @@
+/**
+ * Startup Record for PIC16F18346
+ *
+ * The record shares HEF row 3 with playlist steps 10-13, so a save reads
+ * the row, changes its 8 bytes and writes the row back (as playlist.c
+ * does for its records).
+ */
+
+#include <xc.h>
+#include "startup.h"
+#include "clock.h"
+#include "hef.h"
+
+#define STARTUP_OFFSET      (3 * HEF_ROW_BYTES + 24)
+#define STARTUP_BYTES       8
+#define STARTUP_MAGIC       0xA5        /* Byte sum of a valid record */
+
+#define REC_MODE            (rec[4] & 0x0F)
+#define REC_POLICY          (rec[4] >> 4)
+
+static uint8_t rec[STARTUP_BYTES];
+static uint8_t valid;
+static uint16_t boot_counts;
+
+static uint8_t byte_sum(const uint8_t *p) {
+    uint8_t sum = 0;
+
+    for (uint8_t i = 0; i < STARTUP_BYTES; i++) {
+        sum += p[i];
+    }
+    return sum;
+}
+
+static uint32_t rec_entry(void) {
+    return (uint32_t)rec[0] | ((uint32_t)rec[1] << 8) |
+           ((uint32_t)rec[2] << 16) | ((uint32_t)rec[3] << 24);
+}
+
+static int16_t rec_fine(void) {
+    return (int16_t)((uint16_t)rec[5] | ((uint16_t)rec[6] << 8));
+}
+
+uint8_t startup_load(uint32_t *entry, uint8_t *mode, int16_t *fine) {
+    hef_read(STARTUP_OFFSET, rec, STARTUP_BYTES);
+    valid = byte_sum(rec) == STARTUP_MAGIC &&
+            REC_MODE <= CLOCK_ISTEP && REC_POLICY <= STARTUP_POT;
+    if (!valid) {
+        rec[4] = STARTUP_LAST << 4;
+        return 0;
+    }
+    if (REC_POLICY == STARTUP_POT) {
+        return 0;
+    }
+    return startup_get(entry, mode, fine);
+}
+
+void startup_mark(void) {
+    uint8_t h, l;
+
+    do {
+        h = TMR5H;
+        l = TMR5L;
+    } while (h != TMR5H);
+    boot_counts = ((uint16_t)h << 8) | l;
+}
+
+uint16_t startup_time_us(void) {
+    return boot_counts / 6;
+}
+
+uint8_t startup_policy(void) {
+    return REC_POLICY;
+}
+
+uint8_t startup_get(uint32_t *entry, uint8_t *mode, int16_t *fine) {
+    if (!valid) {
+        return 0;
+    }
+    *entry = rec_entry();
+    *mode = REC_MODE;
+    *fine = rec_fine();
+    return 1;
+}
+
+uint8_t startup_same(uint32_t entry, uint8_t mode, int16_t fine) {
+    return valid && rec_entry() == entry && REC_MODE == mode &&
+           rec_fine() == fine;
+}
+
+uint8_t startup_save(uint32_t entry, uint8_t mode, int16_t fine, uint8_t policy) {
+    uint8_t row[HEF_ROW_BYTES];
+    uint8_t base = STARTUP_OFFSET & ~(HEF_ROW_BYTES - 1);
+    uint8_t i;
+
+    rec[0] = (uint8_t)entry;
+    rec[1] = (uint8_t)(entry >> 8);
+    rec[2] = (uint8_t)(entry >> 16);
+    rec[3] = (uint8_t)(entry >> 24);
+    rec[4] = (uint8_t)(mode | (policy << 4));
+    rec[5] = (uint8_t)fine;
+    rec[6] = (uint8_t)((uint16_t)fine >> 8);
+    rec[7] = 0;
+    rec[7] = STARTUP_MAGIC - byte_sum(rec);
+    valid = 1;
+
+    hef_read(base, row, HEF_ROW_BYTES);
+    for (i = 0; i < STARTUP_BYTES; i++) {
+        row[STARTUP_OFFSET - base + i] = rec[i];
+    }
+    return hef_write_row(base / HEF_ROW_BYTES, row, HEF_ROW_BYTES);
+}
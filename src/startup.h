@@ -0,0 +1,67 @@
+/**
+ * Startup Record for PIC16F18346
+ *
+ * What the output does at power-up: the last-used frequency, fine tune
+ * and host mode (STARTUP_LAST, kept up to date by main.c), a pinned one
+ * (STARTUP_PINNED, `O pin`), or the pot as read at reset (STARTUP_POT).
+ * main() starts the output from it before any other initialisation, so
+ * RB6 runs (or stays parked) without waiting for the settings or the
+ * ADC; startup_time_us() gives the measured time from main(). The pot
+ * only takes over once it moves.
+ *
+ * Stored in HEF row 3, bytes 24-31 (after the 14 playlist steps):
+ *
+ *   byte 0-3  freq_table entry (little-endian)
+ *   byte 4    mode (CLOCK_*, bits 0-3), policy (STARTUP_*, bits 4-7)
+ *   byte 5-6  fine tune, ppm (fine.h, little-endian)
+ *   byte 7    makes the byte sum STARTUP_MAGIC
+ *
+ * An erased or damaged record reads as STARTUP_LAST with no entry: the
+ * first power-up starts from the pot as before.
+ */
+
+#ifndef STARTUP_H
+#define STARTUP_H
+
+#include <stdint.h>
+
+#define STARTUP_LAST        0   /* Follow the output (autosaved) */
+#define STARTUP_PINNED      1   /* Fixed entry and mode */
+#define STARTUP_POT         2   /* Pot at reset, nothing saved */
+
+/**
+ * Read the record. Returns nonzero with the entry, mode and fine tune to
+ * start in, 0 to start from the pot.
+ */
+uint8_t startup_load(uint32_t *entry, uint8_t *mode, int16_t *fine);
+
+/**
+ * Record that the output is running: TMR5 (Fosc/4, started at the top of
+ * main) gives the time since main() was entered.
+ */
+void startup_mark(void);
+
+/**
+ * Time from main() to the output running, µs (T report).
+ */
+uint16_t startup_time_us(void);
+
+/**
+ * Current policy (STARTUP_*) and stored entry/mode/fine tune (valid
+ * unless the record is blank: returns 0).
+ */
+uint8_t startup_policy(void);
+uint8_t startup_get(uint32_t *entry, uint8_t *mode, int16_t *fine);
+
+/**
+ * Nonzero if the record already holds this entry, mode and fine tune.
+ */
+uint8_t startup_same(uint32_t entry, uint8_t mode, int16_t fine);
+
+/**
+ * Write the record (one HEF row write, ~4.5 ms with interrupts off).
+ * Returns nonzero on success.
+ */
+uint8_t startup_save(uint32_t entry, uint8_t mode, int16_t fine, uint8_t policy);
+
+#endif /* STARTUP_H */
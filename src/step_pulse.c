@@ -0,0 +1,200 @@
+/**
+ * Step Pulse Generator for PIC16F18346
+ *
+ * CCP3 register usage:
+ *
+ *   CCPTMRS.C3TSEL = 0b10   CCP3 timebase = TMR3 (clock.c, never written)
+ *   CCP3CON = 0x89          compare, clear output on match; the output is
+ *                           set when the mode is written (falling edge)
+ *   CCP3CON = 0x88          compare, set output on match; the output is
+ *                           cleared when the mode is written (rising edge)
+ *   RB6PPS  = 0x0E          CCP3 output (Table 13-3), only while the
+ *                           falling edge is armed and during the pulse
+ *
+ * Each mode write happens while the CCP3 output already has the level
+ * it initialises to, so switching modes and PPS never glitches RB6.
+ *
+ * Edges further than one TMR3 wrap away (auto-repeat gaps) are reached
+ * in steps of half a wrap with RB6 on LATB6; the compare is only routed
+ * to the pin once the falling edge is less than a wrap ahead, at least
+ * half a wrap (5.5 ms) before it.
+ *
+ * CLC2 (debounced button) interrupts on its falling edge: LC2INTN in
+ * CLC2CON, CLC2IF/CLC2IE in PIR3/PIE3.
+ */
+
+#include <xc.h>
+#include "step_pulse.h"
+#include "clc_debounce.h"
+
+#define PPS_LAT             0x00
+#define PPS_CCP3            0x0E
+
+#define CCP3_FALL           0x89
+#define CCP3_RISE           0x88
+
+#define COUNTS_PER_US       6       /* TMR3 = Fosc/4 */
+#define LATENCY_COUNTS      ((uint16_t)(STEP_PULSE_LATENCY_US * COUNTS_PER_US))
+#define DELAY_COUNTS        (STEP_PULSE_DELAY_MS * 1000UL * COUNTS_PER_US)
+#define LEAD_COUNTS         60      /* 10 µs: time to arm a late edge */
+
+#define BTN_DOWN()          (CLCDATAbits.MLC2OUT == 0)
+
+/* Pulse states */
+#define ST_IDLE             0
+#define ST_WAIT             1       /* Gap: half-wrap steps, RB6 on LATB6 */
+#define ST_FALL             2       /* Falling edge armed on RB6 */
+#define ST_LOW              3       /* Pulse running, rising edge armed */
+
+static uint8_t enabled;
+static volatile uint8_t state;
+static volatile uint8_t repeat;         /* Repeat while the button is held */
+static volatile uint8_t first;          /* Next gap is the start delay */
+static volatile uint16_t edge;          /* TMR3 time of the armed compare */
+static volatile uint32_t left;          /* Counts from `edge` to the fall */
+static volatile uint16_t width;         /* Pulse width, TMR3 counts */
+static volatile uint32_t period;        /* Repeat period, 0 = no repeat */
+
+static uint16_t tmr3_now(void) {
+    uint8_t h, l;
+    do {
+        h = TMR3H;
+        l = TMR3L;
+    } while (h != TMR3H);
+    return ((uint16_t)h << 8) | l;
+}
+
+static void set_compare(uint16_t at, uint8_t mode) {
+    CCP3CON = 0x00;
+    CCPR3H = (uint8_t)(at >> 8);
+    CCPR3L = (uint8_t)at;
+    CCP3CON = mode;
+}
+
+/* Program the next compare on the way to a falling edge `left` ahead */
+static void next_fall(void) {
+    if (left < 0x10000UL) {
+        edge += (uint16_t)left;
+        set_compare(edge, CCP3_FALL);   // Output set: RB6 stays high
+        RB6PPS = PPS_CCP3;
+        state = ST_FALL;
+    } else {
+        edge += 0x8000;
+        left -= 0x8000;
+        set_compare(edge, CCP3_FALL);   // Not on the pin yet
+        state = ST_WAIT;
+    }
+}
+
+static void stop(void) {
+    PIE4bits.CCP3IE = 0;
+    LATBbits.LATB6 = 1;
+    RB6PPS = PPS_LAT;
+    CCP3CON = 0x00;
+    state = ST_IDLE;
+}
+
+/* Falling edge LATENCY_COUNTS after `from`, or as soon as possible if late */
+static void start(uint16_t from, uint8_t rep) {
+    uint16_t now = tmr3_now();
+
+    edge = from + LATENCY_COUNTS;
+    if ((int16_t)(edge - now) < LEAD_COUNTS) {
+        edge = now + LEAD_COUNTS;
+    }
+    left = 0;
+    repeat = rep;
+    first = 1;
+    next_fall();
+    PIR4bits.CCP3IF = 0;
+    PIE4bits.CCP3IE = 1;
+}
+
+void step_pulse_init(void) {
+    CCPTMRSbits.C3TSEL = 0b10;          // CCP3 timebase = TMR3
+    CCP3CON = 0x00;
+    PIE4bits.CCP3IE = 0;
+    state = ST_IDLE;
+    enabled = 0;
+    PIE3bits.CLC2IE = 0;
+
+    step_pulse_config(STEP_PULSE_WIDTH_MAX, 0);
+}
+
+void step_pulse_config(uint16_t width_us, uint16_t repeat_ms) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    width = width_us * COUNTS_PER_US;
+    period = (uint32_t)repeat_ms * (1000UL * COUNTS_PER_US);
+    INTCONbits.GIE = gie;
+}
+
+void step_pulse_enable(uint8_t on) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    enabled = on;
+    if (!on && state != ST_IDLE) {
+        stop();
+    }
+    // Here, not in step_pulse_init, so neither init order loses it
+    CLC2CONbits.LC2INTN = 1;            // Interrupt on press (falling edge)
+    PIR3bits.CLC2IF = 0;
+    PIE3bits.CLC2IE = on;
+    INTCONbits.GIE = gie;
+}
+
+uint8_t step_pulse_fire(void) {
+    uint8_t gie = INTCONbits.GIE;
+    uint8_t ok = 0;
+
+    di();
+    if (enabled && state == ST_IDLE) {
+        start(tmr3_now(), 0);
+        ok = 1;
+    }
+    INTCONbits.GIE = gie;
+    return ok;
+}
+
+uint8_t step_pulse_busy(void) {
+    return state != ST_IDLE;
+}
+
+void step_pulse_isr(void) {
+    if (PIE3bits.CLC2IE && PIR3bits.CLC2IF) {
+        PIR3bits.CLC2IF = 0;
+        if (state == ST_IDLE) {
+            // Measured from the debounce tick that saw the press
+            start(tmr3_now() - clc_debounce_age(), period != 0);
+        }
+    }
+
+    if (PIE4bits.CCP3IE && PIR4bits.CCP3IF) {
+        PIR4bits.CCP3IF = 0;
+        switch (state) {
+            case ST_WAIT:
+                next_fall();
+                break;
+            case ST_FALL:               // RB6 has just gone low
+                edge += width;
+                set_compare(edge, CCP3_RISE);   // Output cleared: stays low
+                state = ST_LOW;
+                break;
+            case ST_LOW:                // RB6 has just gone high
+                LATBbits.LATB6 = 1;
+                RB6PPS = PPS_LAT;
+                if (repeat && BTN_DOWN()) {
+                    left = (first ? DELAY_COUNTS : period) - width;
+                    first = 0;
+                    next_fall();
+                } else {
+                    stop();
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/**
+ * Step Pulse Generator for PIC16F18346
+ *
+ * In step mode RB6 is driven by CCP3 in compare mode on the free-running
+ * TMR3 (Fosc/4, 166.7 ns per count), so both edges of a step pulse come
+ * from hardware and its width is exact to one TMR3 count:
+ *
+ *   Falling edge: CCP3 "clear output on match", routed to RB6 via PPS
+ *   Rising edge:  CCP3 "set output on match", width after the fall
+ *
+ * Between pulses RB6 is returned to LATB6 (high), and the compare ISR
+ * only reprograms CCP3 for the next edge, so ISR latency never moves an
+ * edge as long as the pulse is longer than it (hence the 100 µs minimum).
+ *
+ * Trigger: the debounced step button (CLC2) interrupts on its falling
+ * edge. CLC2 only changes on a debounce sample tick, and the age of that
+ * tick is known from the sampling timer (clc_debounce_age), so the
+ * falling edge is placed STEP_PULSE_LATENCY_US after the tick that
+ * registered the press, within ±6 µs (half a sampling timer count).
+ *
+ * Auto-repeat: while the button stays down, pulses repeat at a fixed
+ * period (step_pulse_config), starting STEP_PULSE_DELAY_MS after the
+ * first falling edge. Each falling edge is scheduled from the previous
+ * one, so the rate does not drift. A pulse always runs to its full width
+ * once started, however short the press.
+ *
+ * CWG1 follows the RB6 pin in step mode, so PHI1/PHI2 pulse with it.
+ */
+
+#ifndef STEP_PULSE_H
+#define STEP_PULSE_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define STEP_PULSE_LATENCY_US   200     /* Debounced press to falling edge */
+#define STEP_PULSE_DELAY_MS     500     /* First press to first repeat */
+
+#define STEP_PULSE_WIDTH_MIN    100     /* µs */
+#define STEP_PULSE_WIDTH_MAX    10000   /* µs; one TMR3 wrap is 10.9 ms */
+#define STEP_PULSE_REPEAT_MIN   20      /* ms, 0 = no auto-repeat */
+
+/**
+ * Set up CCP3 on TMR3 and the CLC2 falling-edge interrupt. TMR3 must
+ * already be running (clock_init). Pulses stay off until enabled.
+ */
+void step_pulse_init(void);
+
+/**
+ * Pulse width in µs (STEP_PULSE_WIDTH_MIN..MAX) and auto-repeat period
+ * in ms (0 or STEP_PULSE_REPEAT_MIN..65535). Used from the next pulse.
+ */
+void step_pulse_config(uint16_t width_us, uint16_t repeat_ms);
+
+/**
+ * Enable (nonzero) in step mode, with RB6 already idle high as GPIO.
+ * Disabling ends a pulse in progress at once and leaves RB6 on LATB6.
+ */
+void step_pulse_enable(uint8_t on);
+
+/**
+ * Start one pulse (no repeat) STEP_PULSE_LATENCY_US from now. Returns 0
+ * if disabled or a pulse is still running.
+ */
+uint8_t step_pulse_fire(void);
+
+/**
+ * Nonzero while a pulse is due, running or repeating.
+ */
+uint8_t step_pulse_busy(void);
+
+/**
+ * CLC2 falling edge and CCP3 compare handler. Call from the ISR on every
+ * interrupt; it checks its own flags.
+ */
+void step_pulse_isr(void);
+
+#endif /* STEP_PULSE_H */
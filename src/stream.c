@@ -0,0 +1,364 @@
+/**
+ * Binary Frequency Streaming
+ *
+ * TMR1 / CCP1 register usage:
+ *
+ *   T1CKIPPS = 0x0E     T1CKI = RB6 (Port B base 0x08, pin 6), read back
+ *                       from the output pin
+ *   T1CON    = 0x83     TMR1CS = T1CKI, 1:1, synchronized, 16-bit
+ *                       read/write, on
+ *   T1GCON   = 0x00     No gate (gated by RC6 only for the halt watch)
+ *   CCP1CON  = 0x82     Enable, compare mode, not routed to a pin
+ *
+ * In burst, count and instruction step modes clc_gate.c takes TMR1/CCP1
+ * for its counted stop (and its interrupt above 65,535 cycles), so frames
+ * are refused with STREAM_ERR_MODE until another mode is selected. In run
+ * mode it borrows them for the halt watch while no stream is running; a
+ * stream takes them back when it starts (clock_release_counter), and
+ * HALT_SEL then halts in firmware until the stream ends.
+ *
+ * TMR1 is never written. Each record boundary is the previous boundary
+ * plus the record's cycle count (mod 2^16), so a boundary lands on the
+ * exact RB6 edge whatever the interrupt latency was.
+ *
+ * The frequency change itself is not in hardware: the NCO has no way to
+ * take a new increment at a counted edge. Each record is staged in
+ * clock.c while the one before it plays, so the load is a few register
+ * writes. On the software clock the clock ISR makes the boundary edge
+ * and loads the record before it schedules the next edge, so the change
+ * is on the edge. On the NCO the CCP1 interrupt loads it, first in the
+ * ISR chain: some 120 instruction cycles (about 20 µs) after the edge,
+ * longer if another handler was running (up to the ISR WCET, T). Those
+ * cycles of the new record run at the old frequency: about 20 at 1 MHz,
+ * and below 50 kHz the load lands within the first cycle. stream_lag
+ * keeps the most cycles measured (TMR1 read after the load), reported
+ * by T.
+ *
+ * Sustained rate: a full frame carries 8 records in 51 bytes, so 115200
+ * baud (11,538 bytes/s) delivers 1,810 records/s. Each record must also
+ * outlast its load and the staging of the next one (some tens of µs) or
+ * it is skipped and reported as STREAM_ERR_LATE; at 1 MHz that is a few
+ * tens of cycles, below about 20 kHz one cycle.
+ *
+ * The ring is written only by the main loop (stream_rx, stream_task) and
+ * read only by the ISR, so neither side needs to lock it. A playlist is
+ * queued into the same ring by stream_task, read ahead from HEF in the
+ * main loop, so no NVM read ever runs in the ISR or delays a boundary.
+ * The task runs every 2 ms and tops the ring up to 15 steps, so steps
+ * must average at least 2 ms / 15 (133 µs) or the ring underruns.
+ */
+
+#include <xc.h>
+#include "stream.h"
+#include "clock.h"
+#include "synth.h"
+#include "uart.h"
+#include "freq_table.h"
+#include "playlist.h"
+
+static stream_rec_t ring[STREAM_RING_SIZE];
+static volatile uint8_t ring_head;
+static volatile uint8_t ring_tail;
+
+static volatile uint8_t running;        /* CCP1 is timing a record */
+static uint8_t active;                  /* Stream owns the frequency */
+static volatile uint8_t from_playlist;  /* Records come from playlist.c */
+static volatile uint8_t play_left;      /* and it has more to queue */
+static volatile uint8_t errors;         /* STREAM_ERR_* since last answer */
+static volatile uint16_t underruns;
+static uint16_t boundary;               /* TMR1 count where the record ends */
+static stream_rec_t next;               /* Record after the current one */
+static volatile uint8_t staged;         /* `next` is staged for `boundary` */
+static volatile uint16_t lag;           /* Most edges a load came after its boundary */
+
+/* Frame receiver */
+static uint8_t rx_state;                /* 0 idle, 1 count, 2 records, 3 sum */
+static uint8_t rx_count;                /* Records in the frame */
+static uint8_t rx_left;                 /* Records still to receive */
+static uint8_t rx_index;                /* Byte within the current record */
+static uint8_t rx_sum;
+static uint8_t rx_stored;               /* Records placed after ring_head */
+static uint8_t rx_bad;                  /* Frame has an invalid record */
+static uint8_t rx_rec[STREAM_REC_BYTES];
+
+static uint8_t ring_free(void) {
+    return (STREAM_RING_SIZE - 1) - ((ring_head - ring_tail) & (STREAM_RING_SIZE - 1));
+}
+
+static uint16_t tmr1_now(void) {
+    uint8_t l = TMR1L;                  /* Latches TMR1H (16-bit read mode) */
+    return ((uint16_t)TMR1H << 8) | l;
+}
+
+uint8_t stream_record_valid(const stream_rec_t *r) {
+    uint32_t value = GET_FREQ_VALUE(r->entry);
+
+    if (r->cycles == 0) {
+        return 0;
+    }
+    if (IS_SOFTWARE_MODE(r->entry)) {
+        return value >= synth_soft_half(SYNTH_SOFT_MAX_MHZ);
+    }
+    return value != 0 && value <= synth_nco_inc(SYNTH_MAX_MHZ);
+}
+
+/* Next record from the ring; 0 if there is none */
+static uint8_t next_record(stream_rec_t *r) {
+    if (ring_tail == ring_head) {
+        return 0;
+    }
+    *r = ring[ring_tail];
+    ring_tail = (ring_tail + 1) & (STREAM_RING_SIZE - 1);
+    return 1;
+}
+
+/* Stage the next record, if there is one, to start at `boundary` */
+static void stage_next(void) {
+    staged = next_record(&next);
+    if (staged) {
+        clock_stage(next.entry, boundary);
+    }
+}
+
+/*
+ * The record ending at `boundary` is over: the staged one takes over and
+ * the one after it is staged. Called from the ISR and, with interrupts
+ * off, to start an idle stream.
+ */
+static void advance(void) {
+    while (staged) {
+        // On the NCO the load comes after the edge; count the edges missed
+        if (clock_load_staged() && running) {
+            uint16_t late = tmr1_now() - boundary;
+            if (late > lag) {
+                lag = late;
+            }
+        }
+        boundary += next.cycles;
+
+        CCPR1H = (uint8_t)(boundary >> 8);
+        CCPR1L = (uint8_t)boundary;
+        stage_next();
+        if ((int16_t)(boundary - tmr1_now()) > 0) {
+            running = 1;
+            PIE4bits.CCP1IE = 1;
+            return;
+        }
+        PIR4bits.CCP1IF = 0;            /* Loaded below instead */
+        errors |= STREAM_ERR_LATE;      /* Already past its end */
+    }
+    running = 0;
+    PIE4bits.CCP1IE = 0;
+}
+
+/* Records were queued: start an idle stream, or stage the next record */
+static void queued(void) {
+    uint8_t gie = INTCONbits.GIE;
+
+    di();
+    if (!running) {
+        boundary = tmr1_now();          /* Start now */
+        stage_next();
+        advance();
+    } else if (!staged) {
+        stage_next();                   /* Arrived before the boundary */
+    }
+    INTCONbits.GIE = gie;
+}
+
+void stream_init(void) {
+    ring_head = ring_tail = 0;
+    running = 0;
+    active = 0;
+    errors = 0;
+    underruns = 0;
+    rx_state = 0;
+
+    T1CON = 0x00;
+    T1GCON = 0x00;
+    T1CKIPPS = 0x0E;
+    TMR1H = 0;
+    TMR1L = 0;
+    T1CON = 0x83;
+
+    CCPTMRSbits.C1TSEL = 0b01;          /* CCP1 timebase = TMR1 */
+    CCP1CON = 0x82;
+    PIR4bits.CCP1IF = 0;
+    PIE4bits.CCP1IE = 0;
+}
+
+uint8_t stream_rx_busy(void) {
+    return rx_state != 0;
+}
+
+/*
+ * Records are written into the free slots after ring_head as they arrive
+ * and only published, by moving ring_head, once the checksum is good.
+ */
+static void frame_done(void) {
+    if (rx_sum != 0) {
+        errors |= STREAM_ERR_SUM;
+    } else if (rx_bad) {
+        errors |= STREAM_ERR_RECORD;    /* Whole frame rejected */
+    } else if (clock_counting()) {
+        errors |= STREAM_ERR_MODE;
+    } else {
+        if (rx_stored < rx_count) {
+            errors |= STREAM_ERR_FULL;
+        }
+        ring_head = (ring_head + rx_stored) & (STREAM_RING_SIZE - 1);
+
+        active = 1;
+        if (!running) {
+            clock_release_counter();    /* Halt watch off, TMR1 ungated */
+        }
+        queued();
+    }
+
+    uint8_t gie = INTCONbits.GIE;
+    di();
+    uint8_t e = errors;
+    errors = 0;
+    INTCONbits.GIE = gie;
+
+    uart_putc(STREAM_ACK);
+    uart_putc(ring_free());
+    uart_putc(e);
+}
+
+static void record_done(void) {
+    stream_rec_t r;
+
+    r.entry = (uint32_t)rx_rec[0] | ((uint32_t)rx_rec[1] << 8) |
+              ((uint32_t)rx_rec[2] << 16) | ((uint32_t)rx_rec[3] << 24);
+    r.cycles = (uint16_t)rx_rec[4] | ((uint16_t)rx_rec[5] << 8);
+
+    if (!stream_record_valid(&r)) {
+        rx_bad = 1;
+    } else if (rx_stored < ring_free()) {
+        ring[(ring_head + rx_stored) & (STREAM_RING_SIZE - 1)] = r;
+        rx_stored++;
+    }
+}
+
+void stream_rx(uint8_t c) {
+    switch (rx_state) {
+        case 0:                         /* STREAM_SYNC */
+            rx_state = 1;
+            rx_sum = 0;
+            break;
+
+        case 1:
+            rx_sum += c;
+            if (c == 0 || c > STREAM_FRAME_MAX) {
+                rx_state = 0;           /* Not a frame; resync on next 0xA5 */
+                errors |= STREAM_ERR_RECORD;
+                break;
+            }
+            if (from_playlist) {
+                stream_stop();          /* Host records replace a playlist */
+            }
+            rx_count = c;
+            rx_left = c;
+            rx_index = 0;
+            rx_stored = 0;
+            rx_bad = 0;
+            rx_state = 2;
+            break;
+
+        case 2:
+            rx_sum += c;
+            rx_rec[rx_index++] = c;
+            if (rx_index == STREAM_REC_BYTES) {
+                record_done();
+                rx_index = 0;
+                if (--rx_left == 0) {
+                    rx_state = 3;
+                }
+            }
+            break;
+
+        default:
+            rx_sum += c;
+            rx_state = 0;
+            frame_done();
+            break;
+    }
+}
+
+uint8_t stream_active(void) {
+    return active;
+}
+
+void stream_stop(void) {
+    PIE4bits.CCP1IE = 0;
+    running = 0;
+    staged = 0;
+    clock_unstage();
+    active = 0;
+    from_playlist = 0;
+    play_left = 0;
+    ring_tail = ring_head;
+}
+
+void stream_play(void) {
+    stream_stop();
+    playlist_rewind();
+    clock_release_counter();
+
+    from_playlist = 1;
+    play_left = 1;
+    active = 1;                         /* stream_task fills and starts */
+}
+
+uint8_t stream_playing(void) {
+    return from_playlist && (running || play_left);
+}
+
+void stream_task(void) {
+    stream_rec_t r;
+
+    if (!from_playlist) {
+        return;
+    }
+    while (play_left && ring_free() != 0) {
+        if (!playlist_next(&r)) {
+            play_left = 0;              /* End of a non-looping list */
+            break;
+        }
+        ring[ring_head] = r;
+        ring_head = (ring_head + 1) & (STREAM_RING_SIZE - 1);
+    }
+    queued();
+}
+
+uint16_t stream_underruns(void) {
+    uint8_t gie = INTCONbits.GIE;
+    uint16_t n;
+
+    di();
+    n = underruns;
+    INTCONbits.GIE = gie;
+    return n;
+}
+
+uint16_t stream_lag(void) {
+    uint8_t gie = INTCONbits.GIE;
+    uint16_t n;
+
+    di();
+    n = lag;
+    INTCONbits.GIE = gie;
+    return n;
+}
+
+void stream_isr(void) {
+    if (running && PIE4bits.CCP1IE && PIR4bits.CCP1IF) {
+        PIR4bits.CCP1IF = 0;
+        if (!staged && (!from_playlist || play_left)) {
+            underruns++;
+            errors |= STREAM_ERR_UNDERRUN;
+        }
+        advance();
+    }
+}
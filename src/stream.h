@@ -0,0 +1,143 @@
+/**
+ * Binary Frequency Streaming
+ *
+ * The host streams (entry, cycles) records over the UART into an on-chip
+ * ring; each record sets the output to a freq_table-format entry (NCO
+ * increment, or software half period with bit 31 set) for a counted
+ * number of output cycles, and the next record takes over at the output
+ * cycle boundary where the previous one ends.
+ *
+ * Frame (all multi-byte fields little-endian):
+ *
+ *   0xA5  n  { entry[4] cycles[2] } × n  sum
+ *
+ *   n       1..STREAM_FRAME_MAX records
+ *   cycles  1..65535 output cycles
+ *   sum     makes the 8-bit sum of every byte after 0xA5 zero
+ *
+ * 0xA5 is not valid ASCII, so frames can be sent between text commands.
+ * Each frame is answered with three bytes:
+ *
+ *   0x5A  free  flags
+ *
+ *   free    records that fit in the ring now
+ *   flags   STREAM_ERR_* bits since the previous answer
+ *
+ * Cycle boundaries are counted in hardware: TMR1 counts RB6 rising edges
+ * and CCP1 compares against the running sum of record lengths, so every
+ * boundary falls on the right edge and latency never accumulates. On the
+ * software clock the new frequency starts on that edge; on the NCO it is
+ * loaded by the boundary interrupt about 20 µs later (stream.c),
+ * so at high frequencies the first cycles of a record run at the old
+ * one. stream_lag reports the most cycles that took.
+ *
+ * The same engine plays the stored playlist (playlist.c) with identical
+ * boundary timing, its steps queued into the ring from HEF by the main
+ * loop (stream_task). A frame's first bytes end a playing playlist.
+ *
+ * Frames are refused (STREAM_ERR_MODE) in burst, count and instruction
+ * step modes, where TMR1/CCP1 implement the counted stop instead.
+ *
+ * Underrun: when a record ends and the ring is empty, the output holds
+ * the last frequency, STREAM_ERR_UNDERRUN is reported and the next record
+ * to arrive is applied immediately. The stream keeps control of the
+ * frequency until an F or P command.
+ */
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stdint.h>
+
+#define STREAM_SYNC         0xA5    /* Frame start */
+#define STREAM_ACK          0x5A    /* Answer start */
+#define STREAM_RING_SIZE    16      /* Records, power of two */
+#define STREAM_FRAME_MAX    8       /* Records per frame */
+
+#define STREAM_ERR_SUM      0x01    /* Frame checksum wrong, frame dropped */
+#define STREAM_ERR_FULL     0x02    /* Ring full, records dropped */
+#define STREAM_ERR_UNDERRUN 0x04    /* Ring ran empty, frequency held */
+#define STREAM_ERR_RECORD   0x08    /* Invalid entry or zero cycles */
+#define STREAM_ERR_LATE     0x10    /* Record ended before it was applied */
+#define STREAM_ERR_MODE     0x20    /* Counted-stop mode owns CCP1, frame dropped */
+
+#define STREAM_REC_BYTES    6       /* entry[4] cycles[2] on the wire/HEF */
+#define STREAM_TASK_MS      2       /* stream_task period (main.c) */
+
+/* Shortest average step a playlist sustains: 15 refills per task period */
+#define STREAM_AVG_STEP_US  ((STREAM_TASK_MS * 1000U + STREAM_RING_SIZE - 2) / \
+                             (STREAM_RING_SIZE - 1))
+
+typedef struct {
+    uint32_t entry;         /* freq_table format */
+    uint16_t cycles;        /* Output cycles, 1..65535 */
+} stream_rec_t;
+
+/**
+ * Configure TMR1 to count RB6 rising edges and CCP1 to compare on it.
+ */
+void stream_init(void);
+
+/**
+ * Nonzero while a frame is being received; its bytes go to stream_rx.
+ */
+uint8_t stream_rx_busy(void);
+
+/**
+ * Feed one received byte (the first one being STREAM_SYNC).
+ */
+void stream_rx(uint8_t c);
+
+/**
+ * Nonzero while the stream controls the output frequency.
+ */
+uint8_t stream_active(void);
+
+/**
+ * Stop streaming and discard queued records; the output stays at the
+ * current frequency.
+ */
+void stream_stop(void);
+
+/**
+ * Play the stored playlist from its first entry, replacing any stream.
+ * The first step starts from the next stream_task run (within 2 ms). At
+ * the end it loops or holds the last frequency (playlist_next).
+ */
+void stream_play(void);
+
+/**
+ * Nonzero while playlist records are being timed or queued.
+ */
+uint8_t stream_playing(void);
+
+/**
+ * Scheduler task: queue playlist steps into the ring ahead of the ISR
+ * (HEF reads stay in the main loop) and start or stage them.
+ */
+void stream_task(void);
+
+/**
+ * Nonzero if a record has a valid entry and a nonzero cycle count.
+ */
+uint8_t stream_record_valid(const stream_rec_t *r);
+
+/**
+ * Number of underruns since reset.
+ */
+uint16_t stream_underruns(void);
+
+/**
+ * Most output cycles a record's frequency came after its boundary
+ * (NCO loads by the interrupt) since reset.
+ */
+uint16_t stream_lag(void);
+
+/**
+ * Record boundary handler (CCP1 compare). Call first in the ISR on
+ * every interrupt, so NCO loads wait for no other handler; it checks
+ * its own flags.
+ */
+void stream_isr(void);
+
+#endif /* STREAM_H */
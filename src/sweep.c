@@ -0,0 +1,144 @@
+/**
+ * Autonomous Frequency Sweep
+ *
+ * Positions are 32-bit fixed point in the law's own domain:
+ *
+ *   SWEEP_LOG  Q8.24 freq_table index (integer part 0..255)
+ *   SWEEP_LIN  Q20.12 NCO increment
+ *
+ * A leg of n = ms ticks outputs the exact start entry on its first tick,
+ * start ± k × delta on tick k, and hands over to the next leg (or the
+ * exact stop entry) on tick n. delta is rounded down, so the last
+ * interpolated step stays inside the range.
+ *
+ * Log positions are interpolated between table entries by
+ * synth_log_entry; each tick costs two table reads and a 24 × 8 bit
+ * multiply.
+ */
+
+#include <xc.h>
+#include "sweep.h"
+#include "synth.h"
+#include "clock.h"
+
+#define LIN_FRAC_BITS   12
+
+static uint8_t law;
+static uint8_t repeat;
+static uint16_t steps;                  /* Ticks per leg */
+static uint32_t delta;
+
+static uint32_t from_pos, to_pos;       /* Current leg end points */
+static uint32_t from_entry, to_entry;
+static uint32_t pos;
+static uint16_t step;
+
+static volatile uint8_t running;        /* Stepping on each tick */
+static volatile uint8_t pending;        /* Start on the next tick */
+static uint8_t active;                  /* Owns the output frequency */
+
+static uint32_t entry_at(uint32_t p) {
+    if (law == SWEEP_LOG) {
+        return synth_log_entry(p);
+    }
+    return (p + (1UL << (LIN_FRAC_BITS - 1))) >> LIN_FRAC_BITS;
+}
+
+/* Back to the start of the leg; returns the entry to retune to */
+static uint32_t leg_start(void) {
+    pos = from_pos;
+    step = 0;
+    return from_entry;
+}
+
+uint8_t sweep_start(const sweep_config_t *cfg) {
+    uint32_t a, b, ea, eb;
+
+    if (cfg->ms == 0 || cfg->repeat > SWEEP_PINGPONG) {
+        return 0;
+    }
+
+    if (cfg->law == SWEEP_LOG) {
+        if (cfg->start_mhz < SWEEP_LOG_MIN_MHZ || cfg->start_mhz > SWEEP_LOG_MAX_MHZ ||
+            cfg->stop_mhz < SWEEP_LOG_MIN_MHZ || cfg->stop_mhz > SWEEP_LOG_MAX_MHZ) {
+            return 0;
+        }
+        a = synth_log_position(cfg->start_mhz);
+        b = synth_log_position(cfg->stop_mhz);
+        ea = synth_solve(cfg->start_mhz);
+        eb = synth_solve(cfg->stop_mhz);
+    } else if (cfg->law == SWEEP_LIN) {
+        ea = synth_nco_inc(cfg->start_mhz);
+        eb = synth_nco_inc(cfg->stop_mhz);
+        uint32_t max = synth_nco_inc(SYNTH_MAX_MHZ);
+        if (ea == 0 || eb == 0 || ea > max || eb > max) {
+            return 0;
+        }
+        a = ea << LIN_FRAC_BITS;
+        b = eb << LIN_FRAC_BITS;
+    } else {
+        return 0;
+    }
+
+    uint32_t d = (b >= a) ? (b - a) / cfg->ms : (a - b) / cfg->ms;
+
+    uint8_t gie = INTCONbits.GIE;
+    di();
+    law = cfg->law;
+    repeat = cfg->repeat;
+    steps = cfg->ms;
+    delta = d;
+    from_pos = a;
+    to_pos = b;
+    from_entry = ea;
+    to_entry = eb;
+    running = 0;
+    pending = 1;
+    active = 1;
+    INTCONbits.GIE = gie;
+    return 1;
+}
+
+void sweep_stop(void) {
+    running = 0;
+    pending = 0;
+    active = 0;
+}
+
+uint8_t sweep_active(void) {
+    return active;
+}
+
+void sweep_tick(void) {
+    if (pending) {
+        pending = 0;
+        running = 1;
+        clock_retune(leg_start());
+        return;
+    }
+    if (!running) {
+        return;
+    }
+
+    if (++step < steps) {
+        pos = (to_pos >= from_pos) ? pos + delta : pos - delta;
+        clock_retune(entry_at(pos));
+        return;
+    }
+
+    if (repeat == SWEEP_ONCE) {
+        running = 0;
+        clock_retune(to_entry);         /* Hold the stop frequency */
+        return;
+    }
+
+    if (repeat == SWEEP_PINGPONG) {
+        uint32_t t = from_pos;
+        from_pos = to_pos;
+        to_pos = t;
+        t = from_entry;
+        from_entry = to_entry;
+        to_entry = t;
+    }
+    clock_retune(leg_start());
+}
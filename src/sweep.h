@@ -0,0 +1,75 @@
+/**
+ * Autonomous Frequency Sweep
+ *
+ * Sweeps the output from a start to a stop frequency, updated every 1 ms
+ * from the scheduler tick interrupt (TMR0), with one of two laws:
+ *
+ *   SWEEP_LOG  Constant ratio per step. The sweep position moves linearly
+ *              through the logarithmic freq_table (1 Hz to 1 MHz) and the
+ *              entry is interpolated between neighbouring table entries,
+ *              so it covers both the software clock and the NCO range.
+ *   SWEEP_LIN  Constant frequency step. The NCO increment moves linearly,
+ *              so both ends must be in the NCO range (11.4 Hz to 1 MHz).
+ *
+ * and one of three repeat options:
+ *
+ *   SWEEP_ONCE      Stop at the stop frequency and hold it
+ *   SWEEP_REPEAT    Sawtooth: jump back to the start every ms milliseconds
+ *   SWEEP_PINGPONG  Triangle: reverse direction at each end
+ *
+ * Every step is a plain increment (or half period) update, never an NCO
+ * disable/enable, so the output is phase-continuous throughout. Steps are
+ * computed by adding a fixed delta precomputed at start, from exact end
+ * points, so a given sweep produces the same sequence of entries at the
+ * same ticks every time it runs.
+ */
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include <stdint.h>
+
+#define SWEEP_LIN       0
+#define SWEEP_LOG       1
+
+#define SWEEP_ONCE      0
+#define SWEEP_REPEAT    1
+#define SWEEP_PINGPONG  2
+
+#define SWEEP_AUTO      0x01    /* flags: start at power-up */
+
+#define SWEEP_LOG_MIN_MHZ   1000UL          /* freq_table range */
+#define SWEEP_LOG_MAX_MHZ   1000000000UL
+
+typedef struct {
+    uint32_t start_mhz;
+    uint32_t stop_mhz;
+    uint16_t ms;            /* Duration of one leg, 1..65535 ms */
+    uint8_t law;            /* SWEEP_LIN / SWEEP_LOG */
+    uint8_t repeat;         /* SWEEP_ONCE / SWEEP_REPEAT / SWEEP_PINGPONG */
+    uint8_t flags;          /* SWEEP_AUTO */
+} sweep_config_t;
+
+/**
+ * Start a sweep at the next tick. Returns 0 (and changes nothing) if the
+ * configuration is out of range for its law.
+ */
+uint8_t sweep_start(const sweep_config_t *cfg);
+
+/**
+ * Stop sweeping; the output stays at the current frequency.
+ */
+void sweep_stop(void);
+
+/**
+ * Nonzero while a sweep runs or holds its stop frequency (SWEEP_ONCE)
+ * and so controls the output frequency.
+ */
+uint8_t sweep_active(void);
+
+/**
+ * Advance one step. Call from the ISR on each 1 ms TMR0 tick.
+ */
+void sweep_tick(void);
+
+#endif /* SWEEP_H */
@@ -0,0 +1,246 @@
+/**
+ * Frequency Synthesis Arithmetic
+ *
+ * All products are split so no intermediate exceeds 32 bits:
+ *
+ *   inc = F_mHz × 512 / 5859375
+ *       = (F / 5859375) × 512 + (F % 5859375) × 512 / 5859375
+ *     (F % 5859375) × 512 < 3.0e9
+ *
+ *   F_mHz = inc × 5859375 / 512 = inc × 11444 + inc × 47 / 512
+ *     (5859375 = 11444 × 512 + 47; inc ≤ 87381 at 1 MHz)
+ *
+ * Fine offsets scale the value by (1 + ppm): the NCO increment change
+ * Δ × 2^16 = inc × ppm × 2^16 / 10^6 (< 2^31 for inc < 2^20, |ppm| ≤
+ * 30000) and the half period half × 10^6 / (10^6 + ppm) both need a
+ * 64-bit product, from synth_muldiv.
+ *
+ * Log positions interpolate linearly between neighbouring table entries
+ * (5.6% apart), in increments for the NCO and in half periods for the
+ * software clock. Where a software entry meets an NCO entry the nearer
+ * one is used.
+ */
+
+#include "freq_table.h"
+#include "synth.h"
+
+#define NCO_DIV             5859375UL   /* 24e9 / 2^21 × 512 */
+#define SOFT_CLOCKS         3000000000UL /* 12e9 mHz·cycles / 4 */
+
+static uint32_t absdiff(uint32_t a, uint32_t b) {
+    return (a > b) ? (a - b) : (b - a);
+}
+
+uint32_t synth_nco_inc(uint32_t mhz) {
+    uint32_t q = mhz / NCO_DIV;
+    uint32_t r = mhz % NCO_DIV;
+    return q * 512 + (r * 512 + NCO_DIV / 2) / NCO_DIV;
+}
+
+uint32_t synth_soft_half(uint32_t mhz) {
+    return ((SOFT_CLOCKS + mhz / 2) / mhz) << 2;
+}
+
+uint32_t synth_mhz(uint32_t entry) {
+    uint32_t value = GET_FREQ_VALUE(entry);
+
+    if (IS_SOFTWARE_MODE(entry)) {
+        uint32_t counts = value >> 2;
+        if (counts == 0) {
+            return 0;
+        }
+        return (SOFT_CLOCKS + counts / 2) / counts;
+    }
+    return value * 11444UL + (value * 47UL + 256) / 512;
+}
+
+uint32_t synth_solve(uint32_t mhz) {
+    if (mhz < SYNTH_MIN_MHZ || mhz > SYNTH_MAX_MHZ) {
+        return SYNTH_INVALID;
+    }
+
+    uint32_t inc = synth_nco_inc(mhz);
+    if (mhz >= SYNTH_SOFT_MAX_MHZ) {
+        return inc;
+    }
+
+    uint32_t soft = FREQ_MODE_SOFTWARE | synth_soft_half(mhz);
+    if (inc != 0 && absdiff(synth_mhz(inc), mhz) <= absdiff(synth_mhz(soft), mhz)) {
+        return inc;
+    }
+    return soft;
+}
+
+uint32_t synth_log_position(uint32_t mhz) {
+    uint8_t lo = 0, hi = 255;
+
+    while (hi - lo > 1) {               /* synth_mhz(table[lo]) <= mhz */
+        uint8_t mid = (uint8_t)((lo + hi) / 2);
+        if (synth_mhz(freq_table[mid]) <= mhz) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint32_t a = synth_mhz(freq_table[lo]);
+    uint32_t b = synth_mhz(freq_table[hi]);
+    if (mhz >= b) {
+        return (uint32_t)hi << 24;
+    }
+    if (mhz <= a || b == a) {
+        return (uint32_t)lo << 24;
+    }
+
+    uint32_t d = b - a;
+    uint32_t frac = (d >= 256) ? (mhz - a) / (d >> 8) : (mhz - a) * 256 / d;
+    if (frac > 255) {
+        frac = 255;
+    }
+    return ((uint32_t)lo << 24) | (frac << 16);
+}
+
+uint32_t synth_log_entry(uint32_t p) {
+    uint8_t k = (uint8_t)(p >> 24);
+    uint8_t f = (uint8_t)(p >> 16);
+    uint32_t a = freq_table[k];
+
+    if (f == 0 || k == 255) {
+        return a;
+    }
+
+    uint32_t b = freq_table[k + 1];
+    if (IS_SOFTWARE_MODE(a) != IS_SOFTWARE_MODE(b)) {
+        return (f < 128) ? a : b;
+    }
+
+    uint32_t va = GET_FREQ_VALUE(a);
+    uint32_t vb = GET_FREQ_VALUE(b);
+    uint32_t v = (vb >= va) ? va + (((vb - va) * f) >> 8)
+                            : va - (((va - vb) * f) >> 8);
+    return (a & FREQ_MODE_MASK) | v;
+}
+
+uint32_t synth_muldiv(uint32_t a, uint32_t b, uint32_t c, uint32_t *rem) {
+    uint32_t hi = 0, lo = 0, q = 0;
+    uint8_t i;
+
+    for (i = 0; i < 32; i++) {
+        hi = (hi << 1) | (lo >> 31);
+        lo <<= 1;
+        if (a & 0x80000000UL) {
+            lo += b;
+            if (lo < b) {
+                hi++;
+            }
+        }
+        a <<= 1;
+    }
+    for (i = 0; i < 32; i++) {
+        uint8_t top = (uint8_t)(hi >> 31);
+        hi = (hi << 1) | (lo >> 31);
+        lo <<= 1;
+        q <<= 1;
+        if (top || hi >= c) {
+            hi -= c;
+            q |= 1;
+        }
+    }
+    *rem = hi;
+    return q;
+}
+
+uint32_t synth_fine(uint32_t entry, int16_t ppm, uint16_t *frac) {
+    uint32_t value = GET_FREQ_VALUE(entry);
+    uint32_t rem;
+
+    *frac = 0;
+    if (ppm == 0) {
+        return value;
+    }
+
+    if (IS_SOFTWARE_MODE(entry)) {
+        uint32_t div = (uint32_t)(1000000L + ppm);
+        uint32_t counts = synth_muldiv(value >> 2, 1000000UL, div, &rem);
+        if (rem >= div - rem) {
+            counts++;
+        }
+        return counts << 2;
+    }
+
+    uint16_t a = (uint16_t)(ppm < 0 ? -ppm : ppm);
+    uint32_t d = synth_muldiv(value, (uint32_t)a << 16, 1000000UL, &rem);
+    uint32_t whole = d >> 16;
+    uint16_t f = (uint16_t)d;
+
+    if (ppm < 0) {
+        if (f != 0) {
+            whole++;                /* v − w − f = (v − w − 1) + (1 − f) */
+            f = (uint16_t)(0x10000UL - f);
+        }
+        *frac = f;
+        return value - whole;
+    }
+    value += whole;
+    if (value >= SYNTH_MAX_INC) {
+        return SYNTH_MAX_INC;
+    }
+    *frac = f;
+    return value;
+}
+
+uint32_t synth_fine_mhz(uint32_t entry, int16_t ppm) {
+    uint16_t frac;
+    uint32_t value = synth_fine(entry, ppm, &frac);
+
+    if (IS_SOFTWARE_MODE(entry)) {
+        return synth_mhz(FREQ_MODE_SOFTWARE | value);
+    }
+    /* frac / 65536 of an increment: frac × 11444.09 / 65536 mHz */
+    return synth_mhz(value) +
+           (((uint32_t)frac * 11444UL + (((uint32_t)frac * 47UL) >> 9) + 0x8000UL) >> 16);
+}
+
+int16_t synth_exact_ppm(uint32_t entry, uint32_t mhz) {
+    uint32_t value = GET_FREQ_VALUE(entry);
+    uint32_t rem, n;
+    uint8_t neg;
+
+    if (value == 0) {
+        return 0;
+    }
+    if (IS_SOFTWARE_MODE(entry)) {
+        /* half × F / 12e9 − 1, in ppm: half × F / 12000 − 10^6 */
+        n = synth_muldiv(value, mhz, 12000UL, &rem);
+        if (rem >= 12000UL - rem) {
+            n++;
+        }
+        neg = (n < 1000000UL);
+        n = neg ? 1000000UL - n : n - 1000000UL;
+    } else {
+        /* (F × 512 − inc × NCO_DIV) / (inc × NCO_DIV), and 10^6 / NCO_DIV
+         * = 512 / 3000; the difference is taken within one NCO_DIV */
+        uint32_t t = mhz % NCO_DIV * 512;
+        uint32_t k = mhz / NCO_DIV * 512 + t / NCO_DIV;
+        uint32_t r = t % NCO_DIV;
+
+        if (k > value) {
+            return INT16_MAX;
+        }
+        if (k == value) {       /* F × 512 − inc × NCO_DIV = (k − inc) × NCO_DIV + r */
+            n = r;
+            neg = 0;
+        } else {
+            if (value - k > 1) {
+                return INT16_MIN;
+            }
+            n = NCO_DIV - r;
+            neg = 1;
+        }
+        n = (n * 512 + 1500 * value) / (3000 * value);
+    }
+    if (n > INT16_MAX) {
+        return neg ? INT16_MIN : INT16_MAX;
+    }
+    return neg ? -(int16_t)n : (int16_t)n;
+}
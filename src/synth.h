@@ -0,0 +1,93 @@
+/**
+ * Frequency Synthesis Arithmetic
+ *
+ * Converts between frequencies in millihertz and freq_table-format
+ * entries (NCO increment, or software half period with bit 31 set), and
+ * back, with 32-bit integer math only:
+ *
+ *   NCO:      F_mHz = inc × 24e9 / 2^21 = inc × 5859375 / 512
+ *   Software: F_mHz = 12e9 / half_period = 3e9 / (half_period / 4)
+ *
+ * The software clock counts in TMR3 units of 4 Fosc cycles, so software
+ * half periods are always multiples of 4. Below 2 kHz the solver uses it
+ * whenever it is closer than the NCO, whose 11.44 Hz step is coarse at
+ * low frequencies; the cost is 2 interrupts per output cycle.
+ *
+ * Exact settings stop at 1 MHz, the top of the pot range: the CWG dead
+ * time (cwg_twophase.h) and the hardware stop of burst, count and istep
+ * modes (clc_gate.h) are only sized for half periods down to 500 ns.
+ *
+ * This file has no hardware dependencies and also builds on the host.
+ */
+
+#ifndef SYNTH_H
+#define SYNTH_H
+
+#include <stdint.h>
+
+#define SYNTH_MIN_MHZ       1000UL          /* 1 Hz */
+#define SYNTH_MAX_MHZ       1000000000UL    /* 1 MHz, as the pot */
+#define SYNTH_SOFT_MAX_MHZ  2000000UL       /* Software clock below 2 kHz */
+#define SYNTH_MAX_INC       0xFFFFFUL       /* 20-bit NCO increment */
+
+#define SYNTH_INVALID       0UL             /* Not a valid entry */
+
+/**
+ * Best entry for a frequency in mHz: the NCO increment, or below
+ * SYNTH_SOFT_MAX_MHZ the software half period if that is closer.
+ * Returns SYNTH_INVALID outside SYNTH_MIN_MHZ..SYNTH_MAX_MHZ.
+ */
+uint32_t synth_solve(uint32_t mhz);
+
+/**
+ * Frequency in mHz actually produced by an entry (rounded).
+ */
+uint32_t synth_mhz(uint32_t entry);
+
+/**
+ * Nearest NCO increment for a frequency in mHz (may be 0).
+ */
+uint32_t synth_nco_inc(uint32_t mhz);
+
+/**
+ * Nearest software half period (Fosc cycles, multiple of 4) for a
+ * frequency in mHz.
+ */
+uint32_t synth_soft_half(uint32_t mhz);
+
+/**
+ * a × b / c with a 64-bit product (shift and subtract); the quotient
+ * must fit 32 bits. The remainder goes to *rem.
+ */
+uint32_t synth_muldiv(uint32_t a, uint32_t b, uint32_t c, uint32_t *rem);
+
+/**
+ * Value of an entry (increment or half period) moved by `ppm` (fine
+ * tune, |ppm| ≤ 30000). For the NCO the fraction of an increment left
+ * over goes to *frac (1/65536) for dithering; software half periods are
+ * rounded to the nearest 4 Fosc cycles and *frac is 0.
+ */
+uint32_t synth_fine(uint32_t entry, int16_t ppm, uint16_t *frac);
+
+/**
+ * Frequency in mHz an entry moved by `ppm` produces on average.
+ */
+uint32_t synth_fine_mhz(uint32_t entry, int16_t ppm);
+
+/**
+ * Fine tune (ppm, rounded) that moves an entry closest to `mhz`: with it,
+ * synth_fine_mhz(entry, ppm) is within 0.5 ppm plus the dithering
+ * resolution of the frequency. Meant for entries near `mhz` (one solved
+ * for it); far away the result saturates at INT16_MIN/MAX.
+ */
+int16_t synth_exact_ppm(uint32_t entry, uint32_t mhz);
+
+/**
+ * Q8.24 position in the logarithmic freq_table (integer part 0..255) of
+ * a frequency within 1 Hz..1 MHz, and the entry at a position. Used by
+ * the log sweep and the pot mapping to move evenly in ratio.
+ */
+uint32_t synth_log_position(uint32_t mhz);
+uint32_t synth_log_entry(uint32_t p);
+
+#endif /* SYNTH_H */
@@ -0,0 +1,95 @@
+/**
+ * Temperature Compensation for PIC16F18346
+ *
+ * FVRCON: TSEN = 1 (indicator on), TSRNG = 1 (high range, 4 junctions,
+ * needs VDD ≥ 3.6 V). The reading is smoothed by a first-order filter
+ * with a time constant of 8 samples (~8 s), kept in 1/16 codes, which is
+ * far faster than a rack warms up and removes ADC noise.
+ *
+ * Curve arithmetic is 32-bit with |d| limited to 150 codes, so the cubic
+ * term (c3·d²/100)·d/100 cannot overflow for any 16-bit coefficient.
+ */
+
+#include <xc.h>
+#include "tempco.h"
+#include "cal.h"
+#include "clock.h"
+#include "settings.h"
+#include "fll.h"
+
+#define D_MAX       150     /* Codes from ref the curve is evaluated over */
+
+static int16_t filt;        /* Filtered reading × 16 */
+static uint8_t seeded;      /* First reading taken as is */
+
+static int16_t clamp_ppm(int32_t v) {
+    if (v > CAL_PPM_MAX) {
+        return CAL_PPM_MAX;
+    }
+    if (v < -CAL_PPM_MAX) {
+        return -CAL_PPM_MAX;
+    }
+    return (int16_t)v;
+}
+
+/* Stored correction, or the reference's estimate while disciplined */
+static int16_t total(void) {
+    int16_t base;
+
+    if (!fll_base(&base)) {
+        base = settings_get()->cal;
+    }
+    return clamp_ppm((int32_t)base + tempco_curve());
+}
+
+void tempco_init(void) {
+    FVRCONbits.TSRNG = 1;
+    FVRCONbits.TSEN = 1;
+    cal_set(settings_get()->cal);
+}
+
+void tempco_sample(uint16_t code) {
+    if (!seeded) {
+        seeded = 1;
+        filt = (int16_t)(code << 4);
+    } else {
+        filt += ((int16_t)(code << 4) - filt) >> 3;
+    }
+    // tempco_apply inline: the ADC task reaches the retune one level up
+    int16_t ppm = total();
+    if (ppm != cal_get()) {
+        cal_set(ppm);
+        clock_reapply();
+    }
+}
+
+void tempco_apply(void) {
+    int16_t ppm = total();
+
+    if (ppm != cal_get()) {
+        cal_set(ppm);
+        clock_reapply();
+    }
+}
+
+uint16_t tempco_code(void) {
+    return (uint16_t)(filt + 8) >> 4;
+}
+
+int16_t tempco_curve(void) {
+    const settings_t *s = settings_get();
+    int32_t d = (int32_t)tempco_code() - s->tc_ref;
+
+    if (s->tc_c1 == 0 && s->tc_c2 == 0 && s->tc_c3 == 0) {
+        return 0;
+    }
+    if (d > D_MAX) {
+        d = D_MAX;
+    } else if (d < -D_MAX) {
+        d = -D_MAX;
+    }
+    int32_t d2 = d * d;
+    return clamp_ppm((int32_t)s->tc_c1 * d +
+                     (int32_t)s->tc_c2 * d2 / 100 +
+                     (int32_t)s->tc_c3 * d2 / 100 * d / 100);
+}
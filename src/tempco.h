@@ -0,0 +1,67 @@
+/**
+ * Temperature Compensation for PIC16F18346
+ *
+ * The crystal's frequency error follows a smooth curve of temperature
+ * (parabolic for tuning forks, cubic for AT cuts). The on-chip
+ * temperature indicator (FVRCON TSEN, high range for VDD = 5 V) is read
+ * through the ADC about once a second, and the correction handed to
+ * cal.c is
+ *
+ *   ppm = A + c1·d + c2·d² + c3·d³,   d = code − ref
+ *
+ * where code is the filtered 10-bit indicator reading (roughly one code
+ * per °C, rising with temperature), A the stored correction (`A`
+ * command, valid at code `ref`) and c1..c3 the stored curve in 0.01 ppm,
+ * 0.0001 ppm and 0.000001 ppm per code, per code² and per code³. The
+ * indicator has no factory calibration on this part, so the curve is in
+ * codes, not °C, and is fitted per unit (`Y` reports the current code).
+ * While fll.c disciplines to a reference, its estimate (less the curve
+ * at the time it was measured) takes the place of A, so in holdover the
+ * curve keeps tracking temperature.
+ *
+ * Only changed corrections are applied: one retune when the reading
+ * moves, never per output cycle. Fractions of an NCO increment are
+ * dithered by clock.c with the rest of the correction (clock.h).
+ *
+ * ADC timing: the temperature conversion is slotted between pot
+ * conversions by the adc task (main.c), so the pot is still sampled
+ * every 20 ms at the same point and the output is never touched.
+ */
+
+#ifndef TEMPCO_H
+#define TEMPCO_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define TEMPCO_ADCON0   0xF5    /* CHS = 111101 temperature indicator, ADON */
+
+/**
+ * Turn on the temperature indicator (high range) and use the stored
+ * correction alone until the first reading.
+ */
+void tempco_init(void);
+
+/**
+ * Feed one 10-bit indicator reading (the first is taken unfiltered);
+ * applies the new correction through cal_set and clock_reapply when it
+ * changes.
+ */
+void tempco_sample(uint16_t code);
+
+/**
+ * Recompute and apply the correction, e.g. after A or Y changed.
+ */
+void tempco_apply(void);
+
+/**
+ * Filtered indicator reading (10-bit ADC code).
+ */
+uint16_t tempco_code(void);
+
+/**
+ * Curve term alone at the current reading, 0.01 ppm (0 without a curve).
+ */
+int16_t tempco_curve(void);
+
+#endif /* TEMPCO_H */
@@ -0,0 +1,143 @@
+/**
+ * EUSART Driver for PIC16F18346
+ *
+ * EUSART register usage (Section 30, DS40001800E):
+ *
+ *   BAUD1CON = 0x08     BRG16 = 1
+ *   TX1STA   = 0x24     TXEN = 1, BRGH = 1, asynchronous
+ *   RC1STA   = 0x90     SPEN = 1, CREN = 1
+ *   SP1BRG   = 51       Fosc / (4 × (51 + 1)) = 115,385 baud
+ *
+ * The ISR is the only writer of rx_head and tx_tail, the main loop the
+ * only writer of rx_tail and tx_head, so the rings need no locking.
+ */
+
+#include <xc.h>
+#include "uart.h"
+
+#define UART_BRG        51
+
+static volatile uint8_t rx_buf[UART_RX_SIZE];
+static volatile uint8_t rx_head;
+static volatile uint8_t rx_tail;
+static volatile uint16_t rx_lost;
+
+static volatile uint8_t tx_buf[UART_TX_SIZE];
+static volatile uint8_t tx_head;
+static volatile uint8_t tx_tail;
+static uint16_t tx_lost;
+
+void uart_init(void) {
+    rx_head = rx_tail = 0;
+    tx_head = tx_tail = 0;
+    rx_lost = tx_lost = 0;
+
+    /* RB7 output, RC7 input, both digital */
+    TRISBbits.TRISB7 = 0;
+    ANSELBbits.ANSB7 = 0;
+    TRISCbits.TRISC7 = 1;
+    ANSELCbits.ANSC7 = 0;
+
+    RB7PPS = 0x14;                  /* TX/CK output, Table 13-3 */
+    RXPPS  = 0x17;                  /* RC7 (Port C base 0x10, pin 7) */
+
+    BAUD1CON = 0x08;
+    SP1BRGH  = 0;
+    SP1BRGL  = UART_BRG;
+    TX1STA   = 0x24;
+    RC1STA   = 0x90;
+
+    PIE1bits.RCIE = 1;
+}
+
+void uart_isr(void) {
+    if (PIE1bits.RCIE && PIR1bits.RCIF) {
+        if (RC1STAbits.OERR) {
+            RC1STAbits.CREN = 0;    /* Clear overrun, restart receiver */
+            RC1STAbits.CREN = 1;
+            rx_lost++;
+        }
+        uint8_t c = RC1REG;
+        uint8_t next = (rx_head + 1) & (UART_RX_SIZE - 1);
+        if (next != rx_tail) {
+            rx_buf[rx_head] = c;
+            rx_head = next;
+        } else {
+            rx_lost++;
+        }
+    }
+
+    if (PIE1bits.TXIE && PIR1bits.TXIF) {
+        if (tx_tail != tx_head) {
+            TX1REG = tx_buf[tx_tail];
+            tx_tail = (tx_tail + 1) & (UART_TX_SIZE - 1);
+        } else {
+            PIE1bits.TXIE = 0;      /* Ring empty */
+        }
+    }
+}
+
+uint8_t uart_available(void) {
+    return (rx_head - rx_tail) & (UART_RX_SIZE - 1);
+}
+
+uint8_t uart_getc(void) {
+    uint8_t c = rx_buf[rx_tail];
+    rx_tail = (rx_tail + 1) & (UART_RX_SIZE - 1);
+    return c;
+}
+
+uint8_t uart_tx_free(void) {
+    return (UART_TX_SIZE - 1) - ((tx_head - tx_tail) & (UART_TX_SIZE - 1));
+}
+
+void uart_putc(uint8_t c) {
+    uint8_t next = (tx_head + 1) & (UART_TX_SIZE - 1);
+    if (next == tx_tail) {
+        tx_lost++;
+        return;
+    }
+    tx_buf[tx_head] = c;
+    tx_head = next;
+    PIE1bits.TXIE = 1;
+}
+
+void uart_puts(const char *s) {
+    while (*s) {
+        uart_putc((uint8_t)*s++);
+    }
+}
+
+/* Repeated subtraction: no 32-bit division on the PIC16 core */
+static const uint32_t pow10[] = {
+    1000000000UL, 100000000UL, 10000000UL, 1000000UL, 100000UL,
+    10000UL, 1000UL, 100UL, 10UL, 1UL
+};
+
+void uart_putdec(uint32_t n, uint8_t frac) {
+    const uint8_t digits = sizeof(pow10) / sizeof(pow10[0]);
+    uint8_t started = 0;
+
+    for (uint8_t i = 0; i < digits; i++) {
+        uint8_t d = 0;
+        while (n >= pow10[i]) {
+            n -= pow10[i];
+            d++;
+        }
+        if (i == digits - frac) {
+            uart_putc('.');
+        }
+        if (d != 0 || started || i >= digits - 1 - frac) {
+            uart_putc('0' + d);
+            started = 1;
+        }
+    }
+}
+
+uint16_t uart_rx_lost(void) {
+    return rx_lost;
+}
+
+uint16_t uart_tx_lost(void) {
+    return tx_lost;
+}
@@ -0,0 +1,73 @@
+/**
+ * EUSART Driver for PIC16F18346
+ *
+ * 115200 baud 8N1 (115,385 actual, +0.16%) on spare pins:
+ *
+ *   RB7 = TX (pin 10)
+ *   RC7 = RX (pin 9)
+ *
+ * Both directions are interrupt-driven through small ring buffers, so
+ * neither reading nor writing ever waits on the line. When the TX ring
+ * is full further characters are dropped and counted rather than
+ * blocking the caller; callers that must not lose output check
+ * uart_tx_free() first.
+ */
+
+#ifndef UART_H
+#define UART_H
+
+#include <xc.h>
+#include <stdint.h>
+
+#define UART_RX_SIZE    32      /* Power of two; ~2.8 ms at 115200 */
+#define UART_TX_SIZE    64      /* Power of two */
+
+/**
+ * Configure the EUSART, route TX/RX via PPS and enable the RX interrupt.
+ */
+void uart_init(void);
+
+/**
+ * Receive/transmit interrupt handler. Call from the ISR on every
+ * interrupt; it checks its own flags.
+ */
+void uart_isr(void);
+
+/**
+ * Number of received characters waiting.
+ */
+uint8_t uart_available(void);
+
+/**
+ * Next received character. Only valid when uart_available() is nonzero.
+ */
+uint8_t uart_getc(void);
+
+/**
+ * Free space in the TX ring.
+ */
+uint8_t uart_tx_free(void);
+
+/**
+ * Queue one character; dropped (and counted) if the TX ring is full.
+ */
+void uart_putc(uint8_t c);
+
+/**
+ * Queue a string.
+ */
+void uart_puts(const char *s);
+
+/**
+ * Queue an unsigned decimal number with frac digits after a decimal
+ * point (0 = integer), e.g. uart_putdec(32764435, 3) → "32764.435".
+ */
+void uart_putdec(uint32_t n, uint8_t frac);
+
+/**
+ * Characters lost: RX ring or hardware overrun, and TX ring full.
+ */
+uint16_t uart_rx_lost(void);
+uint16_t uart_tx_lost(void);
+
+#endif /* UART_H */
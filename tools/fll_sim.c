@@ -0,0 +1,107 @@
+/**
+ * Reference Discipline Simulator (host)
+ *
+ * Runs the firmware's loop filter (src/fll_loop.c, compiled unchanged)
+ * against a simulated 1 PPS reference and crystal, and reports how long
+ * the loop takes to lock and settle and how far its estimate stays from
+ * the true crystal error afterwards.
+ *
+ * Model: the crystal runs `ppm` fast (plus `drift` ppm per hour); TMR3
+ * counts Fosc/4 and CCP4 captures the integer count at each reference
+ * edge, so quantization and the carry between gates are as on the part.
+ * Each edge is moved by Gaussian noise of `jitter` ns RMS (GPS 1 PPS:
+ * 10-50 ns). Every `gap` seconds (0 = never) the reference drops out for
+ * 10 s to exercise the outlier path.
+ *
+ *   cc -O2 -I src -o fll_sim tools/fll_sim.c src/fll_loop.c -lm
+ *   ./fll_sim [ppm [jitter_ns [seconds [drift [gap]]]]]
+ *
+ * Exits with 1 if the loop did not lock or its settled error exceeds
+ * 0.05 ppm plus the drift over one averaging time.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "fll_loop.h"
+
+#define TMR3_HZ     6000000.0
+#define SETTLE_PPM  0.1         /* "Settled": estimate within this */
+#define PASS_PPM    0.05
+
+static double gauss(void) {
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double v = (rand() + 1.0) / (RAND_MAX + 2.0);
+
+    return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
+
+int main(int argc, char **argv) {
+    double ppm = argc > 1 ? atof(argv[1]) : 23.7;
+    double jitter = argc > 2 ? atof(argv[2]) : 30.0;
+    int seconds = argc > 3 ? atoi(argv[3]) : 1200;
+    double drift = argc > 4 ? atof(argv[4]) : 0.0;
+    int gap = argc > 5 ? atoi(argv[5]) : 0;
+
+    fll_loop_t loop;
+    double phase = 0.0;         /* Crystal time in TMR3 counts */
+    long long last = -1;
+    int locked_at = -1, settled_at = -1;
+    double worst = 0.0, sum2 = 0.0;
+    int n = 0, dropped = 0;
+
+    srand(1);
+    fll_loop_reset(&loop);
+
+    for (int t = 1; t <= seconds; t++) {
+        double p = ppm + drift * t / 3600.0;
+
+        phase += TMR3_HZ * (1.0 + p * 1e-6);
+        if (gap != 0 && t % gap < 10) {
+            continue;           /* Reference missing */
+        }
+        long long cap = (long long)floor(phase + gauss() * jitter * 1e-9 * TMR3_HZ);
+
+        if (last >= 0) {
+            uint8_t g = fll_loop_update(&loop, (int32_t)(cap - last - FLL_GATE_COUNTS));
+            double est = loop.est / (100.0 * FLL_UNIT);
+            double err = est - p;
+
+            if (g == FLL_GATE_BAD) {
+                dropped++;
+            }
+            if (g == FLL_GATE_LOCK && locked_at < 0) {
+                locked_at = t;
+            }
+            if (fabs(err) > SETTLE_PPM) {
+                settled_at = -1;
+            } else if (settled_at < 0) {
+                settled_at = t;
+            }
+            if (t > seconds / 2) {
+                if (fabs(err) > worst) {
+                    worst = fabs(err);
+                }
+                sum2 += err * err;
+                n++;
+            }
+        }
+        last = cap;
+    }
+
+    double limit = PASS_PPM + fabs(drift) * (1 << FLL_SHIFT_MAX) / 3600.0;
+
+    printf("crystal %+.3f ppm, drift %.3f ppm/h, jitter %.0f ns, %d s\n",
+           ppm, drift, jitter, seconds);
+    printf("locked after %d s, within %.2f ppm after %d s, %d gates dropped\n",
+           locked_at, SETTLE_PPM, settled_at, dropped);
+    printf("second half: rms %.4f ppm, max %.4f ppm (limit %.4f)\n",
+           n ? sqrt(sum2 / n) : 0.0, worst, limit);
+
+    if (locked_at < 0 || worst > limit) {
+        printf("FAIL\n");
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * Preset Error Report (host)
+ *
+ * Solves each default preset (src/preset.h) the way the firmware does,
+ * with src/synth.c compiled unchanged, and prints the entry, the fine
+ * tune, the average frequency produced and its error. Run by the opt-in
+ * `make presets` target (not part of `make`), or by hand:
+ *
+ *   cc -O2 -I src -o presets tools/presets.c src/synth.c src/freq_table.c
+ *   ./presets
+ *
+ * The error is that of the synthesis alone, with an exact 24 MHz crystal;
+ * the crystal correction (A, Y, D) applies on top as for any output.
+ * Exits with 1 if a preset cannot be produced at all.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include "synth.h"
+#include "preset.h"
+#include "freq_table.h"
+
+int main(void) {
+    static const uint32_t presets[PRESET_MAX] = PRESET_DEFAULTS;
+    int bad = 0;
+
+    printf("slot  preset Hz       clock  value     ppm  achieved Hz       error ppm\n");
+    for (int i = 0; i < PRESET_MAX; i++) {
+        uint32_t mhz = presets[i];
+        uint32_t entry = synth_solve(mhz);
+        int16_t ppm;
+        uint16_t frac;
+        uint32_t value;
+        double hz;
+
+        if (entry == SYNTH_INVALID) {
+            printf("%4d  %14.3f  out of range\n", i, mhz / 1000.0);
+            bad = 1;
+            continue;
+        }
+        ppm = synth_exact_ppm(entry, mhz);
+        value = synth_fine(entry, ppm, &frac);
+        if (IS_SOFTWARE_MODE(entry)) {
+            hz = 12e6 / value;
+        } else {
+            hz = (value + frac / 65536.0) * 24e6 / (1 << 21);
+        }
+        printf("%4d  %14.3f  %-5s  %-8lu  %4d  %16.4f  %+9.4f\n",
+               i, mhz / 1000.0, IS_SOFTWARE_MODE(entry) ? "sw" : "nco",
+               (unsigned long)GET_FREQ_VALUE(entry), ppm, hz,
+               (hz * 1000.0 / mhz - 1.0) * 1e6);
+    }
+    return bad;
+}
@@ -0,0 +1,243 @@
+/**
+ * Spread-Spectrum Analyser (host)
+ *
+ * Simulates the NCO output edges under the firmware's spread-spectrum
+ * modulation (src/spread_profile.c and src/synth.c, compiled unchanged)
+ * and computes the spectrum of the resulting square wave around its odd
+ * harmonics, as a receiver with resolution bandwidth `rbw` would see it.
+ *
+ * Model: NCO1 in FDC mode at Fosc = 24 MHz. The 20-bit accumulator adds
+ * the increment every Fosc cycle and the output toggles on each overflow,
+ * so edges fall on the Fosc grid with the NCO's own jitter. The timer ISR
+ * loads the next offset every step exactly (interrupt latency moves the
+ * load points, but by the same amount on average, so the mean is
+ * unchanged). The spectrum is the Fourier transform of the edges over a
+ * whole number of modulation periods, integrated exactly between edges;
+ * a receiver reading is the largest power within any `rbw` window, in dB
+ * relative to the unmodulated line at the same harmonic.
+ *
+ *   cc -O2 -I src -o spread_spectrum tools/spread_spectrum.c \
+ *       src/spread_profile.c src/synth.c src/freq_table.c -lm
+ *   ./spread_spectrum [hz [depth_% [rate_hz [tri|kiss [harmonic [rbw_hz]]]]]]
+ *
+ * Defaults: 1 MHz, ±0.5 %, 250 Hz, tri, harmonic 5 in detail, 9 kHz
+ * (CISPR 16 band B). Prints the reduction at each odd harmonic up to
+ * the 15th and the spectrum around the chosen one. Exits with 1 if the
+ * mean frequency over a modulation period differs from the unmodulated
+ * one by any amount.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <complex.h>
+#include "spread_profile.h"
+#include "synth.h"
+
+#define FOSC        24000000.0
+#define ACC_BITS    20
+#define PERIODS     4           /* Modulation periods analysed */
+#define ROWS        41          /* Spectrum rows around the harmonic */
+#define GAP_CACHE   64
+#define RESYNC      1024        /* Edges between exact phases */
+
+typedef struct {
+    long long *t;               /* Edge times, Fosc cycles */
+    long n;
+    long long span;             /* Analysed length, Fosc cycles */
+    int first;                  /* Output level before the first edge */
+} edges_t;
+
+/* Run the accumulator over PERIODS modulation periods */
+static void simulate(uint32_t inc, const uint16_t *mag, long long step,
+                     edges_t *e, unsigned long long *advance) {
+    long cap = (long)(2.0 * inc * step * SPREAD_STEPS * PERIODS / (1 << ACC_BITS)) + 16;
+    unsigned long long acc = 12345;     /* Arbitrary start phase */
+    unsigned long long total = 0;
+    long long t0 = 0;
+
+    e->t = malloc(sizeof(long long) * (size_t)cap);
+    e->n = 0;
+    e->first = 0;
+    e->span = step * SPREAD_STEPS * PERIODS;
+    for (int p = 0; p < PERIODS * SPREAD_STEPS; p++) {
+        long long v = (long long)inc + (mag ? spread_offset(mag, (uint8_t)(p % SPREAD_STEPS)) : 0);
+        unsigned long long end = acc + (unsigned long long)v * (unsigned long long)step;
+        unsigned long long wrap = (acc >> ACC_BITS) + 1;
+
+        // Overflow m happens on the first cycle the sum reaches m × 2^20
+        while ((wrap << ACC_BITS) <= end) {
+            unsigned long long need = (wrap << ACC_BITS) - acc;
+            long long c = (long long)((need + (unsigned long long)v - 1) / (unsigned long long)v);
+            if (e->n < cap) {
+                e->t[e->n++] = t0 + c;
+            }
+            wrap++;
+        }
+        acc = end;
+        total += (unsigned long long)v * (unsigned long long)step;
+        t0 += step;
+    }
+    *advance = total;
+}
+
+/* Fourier coefficient of the ±1 square wave at f (Hz), over the span */
+static double complex coefficient(const edges_t *e, double f) {
+    double w = 2.0 * M_PI * f / FOSC;   /* Radians per Fosc cycle */
+    double complex sum = 0;
+    double complex prev = 1.0;          /* e^{-jw·0} */
+    double complex rot[GAP_CACHE];
+    long long gap[GAP_CACHE];
+    long long last = 0;
+    int s = e->first ? 1 : -1;
+
+    // Edge gaps take a few values only, so each edge's phase is the last
+    // one turned by a cached e^{-jw·gap}, and resynchronised now and then
+    memset(gap, 0, sizeof(gap));
+    for (long i = 0; i < e->n; i++) {
+        long long g = e->t[i] - last;
+        int slot = (int)(g % GAP_CACHE);
+        double complex cur;
+
+        if (i % RESYNC == 0) {
+            cur = cexp(-I * w * (double)e->t[i]);
+        } else {
+            if (gap[slot] != g) {
+                gap[slot] = g;
+                rot[slot] = cexp(-I * w * (double)g);
+            }
+            cur = prev * rot[slot];
+        }
+        sum += s * (prev - cur);
+        prev = cur;
+        last = e->t[i];
+        s = -s;
+    }
+    sum += s * (prev - cexp(-I * w * (double)e->span));
+    return sum / (I * w * (double)e->span);
+}
+
+/* Power spectrum on a grid of bins 1/span apart around centre ± half */
+static void spectrum(const edges_t *e, double centre, double half,
+                     double **pw, int *bins, double *df) {
+    *df = FOSC / (double)e->span;
+    *bins = 2 * (int)ceil(half / *df) + 1;
+    *pw = malloc(sizeof(double) * (size_t)*bins);
+    double f0 = centre - (*bins / 2) * *df;
+
+    for (int b = 0; b < *bins; b++) {
+        double complex c = coefficient(e, f0 + b * *df);
+        (*pw)[b] = creal(c) * creal(c) + cimag(c) * cimag(c);
+    }
+}
+
+/* Largest power within any rbw window; *at gets its centre bin */
+static double receiver(const double *pw, int bins, double df, double rbw, int *at) {
+    int w = (int)(rbw / df);
+    double best = 0.0;
+
+    if (w < 1) {
+        w = 1;
+    }
+    for (int b = 0; b + w <= bins; b++) {
+        double sum = 0.0;
+        for (int i = 0; i < w; i++) {
+            sum += pw[b + i];
+        }
+        if (sum > best) {
+            best = sum;
+            if (at) {
+                *at = b + w / 2;
+            }
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+    double hz = argc > 1 ? atof(argv[1]) : 1000000.0;
+    double pct = argc > 2 ? atof(argv[2]) : 0.5;
+    int rate = argc > 3 ? atoi(argv[3]) : 250;
+    int profile = (argc > 4 && strcmp(argv[4], "kiss") == 0) ? SPREAD_KISS : SPREAD_TRI;
+    int detail = argc > 5 ? atoi(argv[5]) : 5;
+    double rbw = argc > 6 ? atof(argv[6]) : 9000.0;
+
+    uint32_t inc = synth_nco_inc((uint32_t)(hz * 1000.0 + 0.5));
+    uint16_t depth = (uint16_t)(pct * 100.0 + 0.5);
+    uint16_t mag[SPREAD_HALF];
+    uint8_t pr;
+
+    if (inc == 0 || hz * 1000.0 > SYNTH_MAX_MHZ || depth > SPREAD_DEPTH_MAX ||
+        rate < SPREAD_RATE_MIN || rate > SPREAD_RATE_MAX || detail < 1 || detail % 2 == 0) {
+        fprintf(stderr, "out of range\n");
+        return 2;
+    }
+    uint8_t prescale = spread_timer((uint16_t)rate, &pr);
+    long long step = 4LL * prescale * (pr + 1);
+    spread_levels(inc, depth, (uint8_t)profile, mag);
+
+    double f = FOSC * inc / (double)(1UL << (ACC_BITS + 1));
+    edges_t plain, spread;
+    unsigned long long adv0, adv1;
+
+    simulate(inc, 0, step, &plain, &adv0);
+    simulate(inc, mag, step, &spread, &adv1);
+
+    printf("%.3f Hz (inc %lu), ±%.2f %% (peak offset %u), %s, rate %.3f Hz, %d steps of %lld cycles\n",
+           f, (unsigned long)inc, depth / 100.0, mag[SPREAD_HALF - 1],
+           profile == SPREAD_TRI ? "triangle" : "kiss",
+           spread_rate_mhz(prescale, pr) / 1000.0, SPREAD_STEPS, step);
+    printf("levels:");
+    for (int k = 0; k < SPREAD_STEPS / 2; k++) {
+        printf(" %d", spread_offset(mag, (uint8_t)k));
+    }
+    printf("\nmean: accumulator advance %llu vs %llu over %d periods, %ld vs %ld edges\n",
+           adv1, adv0, PERIODS, spread.n, plain.n);
+
+    printf("\nharmonic  spread Hz     rbw %.0f Hz: reduction dB\n", rbw);
+    for (int h = 1; h <= 15; h += 2) {
+        double half = h * f * depth / 10000.0 * 1.2 + 2 * rbw;
+        double *p0, *p1, df;
+        int b0, b1;
+
+        spectrum(&plain, h * f, half, &p0, &b0, &df);
+        spectrum(&spread, h * f, half, &p1, &b1, &df);
+        double r = 10.0 * log10(receiver(p0, b0, df, rbw, 0) / receiver(p1, b1, df, rbw, 0));
+        printf("%8d  %10.0f  %10.2f\n", h, 2.0 * h * f * depth / 10000.0, r);
+
+        if (h == detail) {
+            double ref = receiver(p0, b0, df, rbw, 0);
+            int per = b1 / ROWS > 0 ? b1 / ROWS : 1;
+            printf("\n  offset Hz   dB (rbw %.0f Hz, harmonic %d)\n", rbw, h);
+            for (int row = 0; row < ROWS && (row + 1) * per <= b1; row++) {
+                int lo = row * per;
+                double sum = 0.0;
+                for (int i = 0; i < per; i++) {
+                    sum += p1[lo + i];
+                }
+                sum *= rbw / (per * df);        /* Scale the row's band to rbw */
+                double off = (lo + per / 2 - b1 / 2) * df;
+                double db = sum > 0 ? 10.0 * log10(sum / ref) : -200.0;
+                int bar = (int)(db + 40.0);
+                printf("  %+9.0f  %6.1f  ", off, db);
+                for (int i = 0; i < bar && i < 40; i++) {
+                    putchar('#');
+                }
+                putchar('\n');
+            }
+            putchar('\n');
+        }
+        free(p0);
+        free(p1);
+    }
+
+    free(plain.t);
+    free(spread.t);
+    if (adv1 != adv0) {
+        printf("FAIL: mean frequency moved\n");
+        return 1;
+    }
+    printf("PASS: mean frequency exact\n");
+    return 0;
+}